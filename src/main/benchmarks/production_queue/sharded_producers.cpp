@@ -0,0 +1,78 @@
+#include <stopwatch/stopwatch.h>
+#include <cpp-benchmark/benchmark.h>
+#include <thread>
+#include <vector>
+
+#include <production_queue.h>
+
+#define PRODUCERS 8
+#define RESOURCES_PER_PRODUCER 100'000
+#define RUNS 50
+
+#define SETUP_BENCHMARK()\
+	TerminalObserver terminal_observer;\
+	chrono::high_resolution_clock::duration run_time;\
+	unsigned run;\
+	float progress;\
+\
+	register_observers(terminal_observer);\
+\
+	observe(progress, percentage_complete);\
+\
+	observe_average(run_time, average_run_time);\
+	observe_minimum(run_time, fastest_run_time);\
+	observe_maximum(run_time, slowest_run_time);\
+
+
+using namespace benchmark;
+using namespace std;
+
+template<typename queue_type>
+chrono::high_resolution_clock::duration produce_and_consume(queue_type& queue) {
+	stopwatch run_stopwatch;
+	vector<thread> producers;
+	for (int i = 0; i < PRODUCERS; i++) {
+		producers.emplace_back([&] {
+			for (int j = 0; j < RESOURCES_PER_PRODUCER; j++) {
+				queue.produce(j);
+			}
+		});
+	}
+
+	for (int i = 0; i < PRODUCERS*RESOURCES_PER_PRODUCER; i++) {
+		queue.consume();
+	}
+	for (auto& producer : producers) {
+		producer.join();
+	}
+
+	return run_stopwatch.lap_time();
+}
+
+int main() {
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		parallel_tools::production_queue<int> queue;
+		benchmark("parallel_tools::production_queue with 8 producers and 1 consumer", RUNS) {
+			run_time = produce_and_consume(queue);
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		parallel_tools::production_queue<int> queue(parallel_tools::queue_backend::double_buffer{PRODUCERS});
+		benchmark("parallel_tools::production_queue with 8 producer shards, 8 producers and 1 consumer", RUNS) {
+			run_time = produce_and_consume(queue);
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+}
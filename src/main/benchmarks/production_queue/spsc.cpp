@@ -0,0 +1,72 @@
+#include <stopwatch/stopwatch.h>
+#include <cpp-benchmark/benchmark.h>
+#include <thread>
+
+#include <production_queue.h>
+
+#define RESOURCES_PER_RUN 1'000'000
+#define SPSC_CAPACITY 4096
+#define RUNS 50
+
+#define SETUP_BENCHMARK()\
+	TerminalObserver terminal_observer;\
+	chrono::high_resolution_clock::duration run_time;\
+	unsigned run;\
+	float progress;\
+\
+	register_observers(terminal_observer);\
+\
+	observe(progress, percentage_complete);\
+\
+	observe_average(run_time, average_run_time);\
+	observe_minimum(run_time, fastest_run_time);\
+	observe_maximum(run_time, slowest_run_time);\
+
+
+using namespace benchmark;
+using namespace std;
+
+template<typename queue_type>
+chrono::high_resolution_clock::duration produce_and_consume(queue_type& queue) {
+	stopwatch run_stopwatch;
+	thread producer([&] {
+		for (int i = 0; i < RESOURCES_PER_RUN; i++) {
+			queue.produce(i);
+		}
+	});
+
+	for (int i = 0; i < RESOURCES_PER_RUN; i++) {
+		queue.consume();
+	}
+	producer.join();
+
+	return run_stopwatch.lap_time();
+}
+
+int main() {
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		parallel_tools::production_queue<int> queue;
+		benchmark("parallel_tools::production_queue with 1 producer and 1 consumer", RUNS) {
+			run_time = produce_and_consume(queue);
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc> queue(SPSC_CAPACITY);
+		benchmark("parallel_tools::production_queue<spsc> with 1 producer and 1 consumer", RUNS) {
+			run_time = produce_and_consume(queue);
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#if defined(PARALLEL_TOOLS_HAS_PARALLEL_STL)
+	#include <execution>
+#endif
+#include <stopwatch/stopwatch.h>
+#include <cpp-benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include <parallel_algorithms.h>
+
+#define MIN_THREADS 2
+#define MAX_THREADS 64
+#define NUMBER_OF_ELEMENTS (1 << 22)
+#define RUNS 50
+
+#define SETUP_BENCHMARK()\
+	TerminalObserver terminal_observer;\
+	chrono::high_resolution_clock::duration run_time;\
+	unsigned run;\
+	float progress;\
+\
+	register_observers(terminal_observer);\
+\
+	observe(progress, percentage_complete);\
+\
+	observe_average(run_time, average_run_time);\
+	observe_minimum(run_time, fastest_run_time);\
+	observe_maximum(run_time, slowest_run_time);\
+
+
+using namespace benchmark;
+using namespace std;
+
+double transform_element(double value) {
+	return sqrt(value)*sin(value);
+}
+
+int main() {
+	vector<double> input(NUMBER_OF_ELEMENTS);
+	iota(input.begin(), input.end(), 0.0);
+	vector<double> output(NUMBER_OF_ELEMENTS);
+
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		benchmark("serial loop transforming "s + to_string(NUMBER_OF_ELEMENTS) + " elements", RUNS) {
+			stopwatch run_stopwatch;
+			transform(input.begin(), input.end(), output.begin(), transform_element);
+			run_time = run_stopwatch.lap_time();
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+
+#if defined(PARALLEL_TOOLS_HAS_PARALLEL_STL)
+	{
+		SETUP_BENCHMARK();
+
+		run = 0;
+		benchmark("std::execution::par transforming "s + to_string(NUMBER_OF_ELEMENTS) + " elements", RUNS) {
+			stopwatch run_stopwatch;
+			transform(execution::par, input.begin(), input.end(), output.begin(), transform_element);
+			run_time = run_stopwatch.lap_time();
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+#endif
+
+	for (unsigned threads = MIN_THREADS; threads <= MAX_THREADS; threads *= 2) {
+		SETUP_BENCHMARK();
+
+		run = 0;
+		parallel_tools::thread_pool pool(threads);
+		string benchmark_description = "parallel_tools::parallel_transform transforming "s + to_string(NUMBER_OF_ELEMENTS) + " elements with " + to_string(threads) + " threads";
+		benchmark(benchmark_description, RUNS) {
+			stopwatch run_stopwatch;
+			parallel_tools::parallel_transform(pool, input, output.begin(), transform_element);
+			run_time = run_stopwatch.lap_time();
+
+			run++;
+			progress = (float)run/RUNS*100.0f;
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#include <stopwatch/stopwatch.h>
+#include <cpp-benchmark/benchmark.h>
+#include <atomic>
+#include <functional>
+
+#include <thread_pool.h>
+
+#define MIN_THREADS 2
+#define MAX_THREADS 64
+#define SPLIT_DEPTH 16
+#define RUNS 50
+
+#define SETUP_BENCHMARK()\
+	TerminalObserver terminal_observer;\
+	chrono::high_resolution_clock::duration run_time;\
+	unsigned run;\
+	float progress;\
+\
+	register_observers(terminal_observer);\
+\
+	observe(progress, percentage_complete);\
+\
+	observe_average(run_time, average_run_time);\
+	observe_minimum(run_time, fastest_run_time);\
+	observe_maximum(run_time, slowest_run_time);\
+
+
+using namespace benchmark;
+using namespace std;
+
+chrono::high_resolution_clock::duration split_recursively(parallel_tools::thread_pool& pool) {
+	constexpr int total_tasks = (1 << (SPLIT_DEPTH + 1)) - 1;
+	atomic<int> executed_tasks(0);
+	promise<void> finished;
+
+	function<void(int)> split = [&](int depth) {
+		if (depth > 0) {
+			pool.exec(split, depth - 1);
+			pool.exec(split, depth - 1);
+		}
+		if (++executed_tasks == total_tasks) {
+			finished.set_value();
+		}
+	};
+
+	stopwatch run_stopwatch;
+	pool.exec(split, SPLIT_DEPTH);
+	finished.get_future().wait();
+	return run_stopwatch.lap_time();
+}
+
+int main() {
+	for (unsigned threads = MIN_THREADS; threads <= MAX_THREADS; threads *= 2) {
+		{
+			SETUP_BENCHMARK();
+
+			run = 0;
+			parallel_tools::thread_pool pool(threads);
+			string benchmark_description = "parallel_tools::thread_pool splitting tasks recursively with "s + to_string(threads) + " threads";
+			benchmark(benchmark_description, RUNS) {
+				run_time = split_recursively(pool);
+
+				run++;
+				progress = (float)run/RUNS*100.0f;
+			}
+		}
+
+		{
+			SETUP_BENCHMARK();
+
+			run = 0;
+			parallel_tools::thread_pool pool(threads, parallel_tools::work_stealing{});
+			string benchmark_description = "parallel_tools::thread_pool with work stealing splitting tasks recursively with "s + to_string(threads) + " threads";
+			benchmark(benchmark_description, RUNS) {
+				run_time = split_recursively(pool);
+
+				run++;
+				progress = (float)run/RUNS*100.0f;
+			}
+		}
+	}
+}
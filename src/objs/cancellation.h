@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+namespace parallel_tools {
+	class task_cancelled : public std::runtime_error {
+		public:
+			task_cancelled() :
+				std::runtime_error("task was cancelled before it finished")
+			{}
+
+		protected:
+			explicit task_cancelled(const char* message) :
+				std::runtime_error(message)
+			{}
+	};
+
+	class deadline_exceeded : public task_cancelled {
+		public:
+			deadline_exceeded() :
+				task_cancelled("task deadline expired before it finished")
+			{}
+	};
+
+	struct no_cancellation {
+		constexpr bool stop_requested() const {
+			return false;
+		}
+
+		void throw_if_stop_requested() const {}
+	};
+
+	class cancellation_token {
+		private:
+			std::shared_ptr<const std::atomic<bool>> cancelled;
+			std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+			friend class cancellation_source;
+
+			explicit cancellation_token(std::shared_ptr<const std::atomic<bool>> cancelled) :
+				cancelled(std::move(cancelled))
+			{}
+
+		public:
+			cancellation_token() = default;
+
+			cancellation_token with_deadline(std::chrono::steady_clock::time_point new_deadline) const {
+				auto token = *this;
+				token.deadline = std::min(deadline, new_deadline);
+				return token;
+			}
+
+			template<typename rep_type, typename period_type>
+			cancellation_token with_timeout(const std::chrono::duration<rep_type, period_type>& timeout) const {
+				return with_deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+			}
+
+			std::chrono::steady_clock::time_point get_deadline() const {
+				return deadline;
+			}
+
+			bool is_cancelled() const {
+				return cancelled && cancelled->load(std::memory_order_relaxed);
+			}
+
+			bool is_expired() const {
+				return deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline;
+			}
+
+			bool stop_requested() const {
+				return is_cancelled() || is_expired();
+			}
+
+			void throw_if_stop_requested() const {
+				if (is_cancelled()) {
+					throw task_cancelled();
+				}
+				if (is_expired()) {
+					throw deadline_exceeded();
+				}
+			}
+	};
+
+	class cancellation_source {
+		private:
+			std::shared_ptr<std::atomic<bool>> cancelled;
+
+		public:
+			cancellation_source() :
+				cancelled(std::make_shared<std::atomic<bool>>(false))
+			{}
+
+			void cancel() {
+				cancelled->store(true, std::memory_order_relaxed);
+			}
+
+			bool is_cancelled() const {
+				return cancelled->load(std::memory_order_relaxed);
+			}
+
+			cancellation_token get_token() const {
+				return cancellation_token(cancelled);
+			}
+	};
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+	#error "coroutine.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <latch>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "task.h"
+#include "task_future.h"
+#include "thread_pool.h"
+
+namespace parallel_tools {
+	namespace coroutine {
+		template<typename value_type>
+		class task;
+
+		template<typename value_type>
+		class task_promise_base {
+			private:
+				using stored_type = typename std::conditional<std::is_void<value_type>::value, std::monostate, value_type>::type;
+
+				struct final_awaiter {
+					bool await_ready() noexcept {
+						return false;
+					}
+
+					template<typename promise_type>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> finished) noexcept {
+						auto continuation = finished.promise().continuation;
+						return continuation ? continuation : std::noop_coroutine();
+					}
+
+					void await_resume() noexcept {}
+				};
+
+			protected:
+				std::variant<std::monostate, stored_type, std::exception_ptr> result;
+
+			public:
+				std::coroutine_handle<> continuation;
+
+				std::suspend_always initial_suspend() noexcept {
+					return {};
+				}
+
+				final_awaiter final_suspend() noexcept {
+					return {};
+				}
+
+				void unhandled_exception() {
+					result.template emplace<2>(std::current_exception());
+				}
+
+				decltype(auto) get_result() {
+					if (result.index() == 2) {
+						std::rethrow_exception(std::get<2>(result));
+					}
+					if constexpr (!std::is_void<value_type>::value) {
+						return std::move(std::get<1>(result));
+					}
+				}
+		};
+
+		template<typename value_type>
+		class task_promise : public task_promise_base<value_type> {
+			public:
+				task<value_type> get_return_object();
+
+				template<typename returned_type>
+				void return_value(returned_type&& value) {
+					this->result.template emplace<1>(std::forward<returned_type>(value));
+				}
+		};
+
+		template<>
+		class task_promise<void> : public task_promise_base<void> {
+			public:
+				task<void> get_return_object();
+
+				void return_void() {
+					result.emplace<1>();
+				}
+		};
+
+		template<typename value_type = void>
+		class task {
+			private:
+				std::coroutine_handle<task_promise<value_type>> handle;
+
+				struct awaiter {
+					std::coroutine_handle<task_promise<value_type>> handle;
+
+					bool await_ready() {
+						return handle.done();
+					}
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+						handle.promise().continuation = awaiting;
+						return handle;
+					}
+
+					decltype(auto) await_resume() {
+						return handle.promise().get_result();
+					}
+				};
+
+			public:
+				using promise_type = task_promise<value_type>;
+
+				explicit task(std::coroutine_handle<promise_type> handle) :
+					handle(handle)
+				{}
+
+				task(task&& other) noexcept :
+					handle(std::exchange(other.handle, nullptr))
+				{}
+
+				task& operator=(task&& other) noexcept {
+					if (this != &other) {
+						if (handle) {
+							handle.destroy();
+						}
+						handle = std::exchange(other.handle, nullptr);
+					}
+					return *this;
+				}
+
+				task(const task&) = delete;
+				task& operator=(const task&) = delete;
+
+				~task() {
+					if (handle) {
+						handle.destroy();
+					}
+				}
+
+				awaiter operator co_await() {
+					return awaiter{handle};
+				}
+		};
+
+		template<typename value_type>
+		task<value_type> task_promise<value_type>::get_return_object() {
+			return task<value_type>(std::coroutine_handle<task_promise<value_type>>::from_promise(*this));
+		}
+
+		inline task<void> task_promise<void>::get_return_object() {
+			return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+		}
+
+		struct detached_coroutine {
+			struct promise_type {
+				detached_coroutine get_return_object() noexcept {
+					return {};
+				}
+
+				std::suspend_never initial_suspend() noexcept {
+					return {};
+				}
+
+				std::suspend_never final_suspend() noexcept {
+					return {};
+				}
+
+				void return_void() noexcept {}
+
+				void unhandled_exception() noexcept {
+					std::terminate();
+				}
+			};
+		};
+
+		template<typename value_type, typename result_type>
+		detached_coroutine await_and_notify(task<value_type>& awaited, result_type& result, std::exception_ptr& exception, std::latch& finished) {
+			try {
+				if constexpr (std::is_void<value_type>::value) {
+					co_await awaited;
+				} else {
+					result.emplace(co_await awaited);
+				}
+			} catch (...) {
+				exception = std::current_exception();
+			}
+			finished.count_down();
+		}
+
+		template<typename value_type>
+		value_type sync_wait(task<value_type> awaited) {
+			using stored_type = typename std::conditional<std::is_void<value_type>::value, std::monostate, value_type>::type;
+			std::optional<stored_type> result;
+			std::exception_ptr exception;
+			std::latch finished(1);
+
+			await_and_notify(awaited, result, exception, finished);
+			finished.wait();
+
+			if (exception) {
+				std::rethrow_exception(exception);
+			}
+			if constexpr (!std::is_void<value_type>::value) {
+				return std::move(*result);
+			}
+		}
+
+		class schedule_awaiter {
+			private:
+				thread_pool& pool;
+
+			public:
+				explicit schedule_awaiter(thread_pool& pool) :
+					pool(pool)
+				{}
+
+				bool await_ready() const noexcept {
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> awaiting) {
+					pool.post(parallel_tools::task([awaiting] {
+						awaiting.resume();
+					}));
+				}
+
+				void await_resume() const noexcept {}
+		};
+
+		template<typename function_type, typename arguments_type, typename return_type>
+		class exec_awaiter {
+			private:
+				using stored_type = typename std::conditional<std::is_void<return_type>::value, std::monostate, return_type>::type;
+
+				thread_pool& pool;
+				function_type function;
+				arguments_type arguments;
+				std::optional<stored_type> result;
+				std::exception_ptr exception;
+
+			public:
+				exec_awaiter(thread_pool& pool, function_type&& function, arguments_type&& arguments) :
+					pool(pool),
+					function(std::move(function)),
+					arguments(std::move(arguments))
+				{}
+
+				bool await_ready() const noexcept {
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> awaiting) {
+					pool.post(parallel_tools::task([this, awaiting] {
+						try {
+							if constexpr (std::is_void<return_type>::value) {
+								std::apply(function, std::move(arguments));
+								result.emplace();
+							} else {
+								result.emplace(std::apply(function, std::move(arguments)));
+							}
+						} catch (...) {
+							exception = std::current_exception();
+						}
+						awaiting.resume();
+					}));
+				}
+
+				return_type await_resume() {
+					if (exception) {
+						std::rethrow_exception(exception);
+					}
+					if constexpr (!std::is_void<return_type>::value) {
+						return std::move(*result);
+					}
+				}
+		};
+
+		inline schedule_awaiter schedule(thread_pool& pool) {
+			return schedule_awaiter(pool);
+		}
+
+		template<
+			typename function_type,
+			typename... args_types,
+			typename return_type = typename std::invoke_result<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::type
+		>
+		auto awaitable_exec(thread_pool& pool, function_type&& function, args_types&&... args) {
+			using stored_function_type = typename std::decay<function_type>::type;
+			auto arguments = std::make_tuple(std::forward<args_types>(args)...);
+			return exec_awaiter<stored_function_type, decltype(arguments), return_type>(pool, stored_function_type(std::forward<function_type>(function)), std::move(arguments));
+		}
+
+		template<typename value_type>
+		class future_awaiter {
+			private:
+				task_future<value_type> future;
+
+			public:
+				explicit future_awaiter(task_future<value_type> future) :
+					future(std::move(future))
+				{}
+
+				bool await_ready() const {
+					return future.is_ready();
+				}
+
+				bool await_suspend(std::coroutine_handle<> awaiting) {
+					return future.add_continuation(parallel_tools::task([awaiting] {
+						awaiting.resume();
+					}));
+				}
+
+				decltype(auto) await_resume() {
+					return future.get();
+				}
+		};
+	}
+
+	template<typename value_type>
+	coroutine::future_awaiter<value_type> operator co_await(task_future<value_type> future) {
+		return coroutine::future_awaiter<value_type>(std::move(future));
+	}
+}
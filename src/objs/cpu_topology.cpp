@@ -0,0 +1,189 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+using namespace std;
+using namespace parallel_tools;
+
+namespace {
+	bool read_line(const string& path, string& line) {
+		ifstream file(path);
+		return file && getline(file, line);
+	}
+
+	unsigned read_number(const string& path, unsigned default_value) {
+		string line;
+		if (!read_line(path, line)) {
+			return default_value;
+		}
+		try {
+			return stoul(line);
+		} catch (const exception&) {
+			return default_value;
+		}
+	}
+
+	unsigned read_last_level_cache(const string& cpu_directory, unsigned default_value) {
+		unsigned highest_level = 0;
+		unsigned last_level_cache = default_value;
+		for (unsigned index = 0;; index++) {
+			auto cache_directory = cpu_directory + "/cache/index" + to_string(index);
+			string shared_cpus;
+			if (!read_line(cache_directory + "/shared_cpu_list", shared_cpus)) {
+				break;
+			}
+			auto level = read_number(cache_directory + "/level", 0);
+			auto cpus = cpu_topology::parse_cpu_list(shared_cpus);
+			if (level >= highest_level && !cpus.empty()) {
+				highest_level = level;
+				last_level_cache = cpus.front();
+			}
+		}
+		return last_level_cache;
+	}
+
+	vector<vector<unsigned>> single_cpu_placements(const vector<unsigned>& cpu_order) {
+		vector<vector<unsigned>> placements;
+		for (auto cpu : cpu_order) {
+			placements.push_back({cpu});
+		}
+		return placements;
+	}
+}
+
+cpu_topology::cpu_topology(vector<logical_cpu> cpus) :
+	cpus(std::move(cpus))
+{}
+
+cpu_topology cpu_topology::read(const string& sysfs_cpu_directory) {
+	string online_cpus;
+	vector<unsigned> cpu_ids;
+	if (read_line(sysfs_cpu_directory + "/online", online_cpus)) {
+		cpu_ids = parse_cpu_list(online_cpus);
+	} else {
+		for (unsigned id = 0; id < max(1u, thread::hardware_concurrency()); id++) {
+			cpu_ids.push_back(id);
+		}
+	}
+
+	vector<logical_cpu> cpus;
+	for (auto id : cpu_ids) {
+		auto cpu_directory = sysfs_cpu_directory + "/cpu" + to_string(id);
+		logical_cpu cpu = {id, id, 0, 0, 0};
+		cpu.core = read_number(cpu_directory + "/topology/core_id", id);
+		cpu.package = read_number(cpu_directory + "/topology/physical_package_id", 0);
+		cpu.last_level_cache = read_last_level_cache(cpu_directory, cpu.package);
+
+		string siblings;
+		if (read_line(cpu_directory + "/topology/thread_siblings_list", siblings)) {
+			auto sibling_ids = parse_cpu_list(siblings);
+			cpu.sibling_rank = find(sibling_ids.begin(), sibling_ids.end(), id) - sibling_ids.begin();
+		}
+		cpus.push_back(cpu);
+	}
+	return cpu_topology(std::move(cpus));
+}
+
+vector<unsigned> cpu_topology::parse_cpu_list(const string& cpu_list) {
+	vector<unsigned> cpus;
+	stringstream list(cpu_list);
+	string range;
+	while (getline(list, range, ',')) {
+		try {
+			auto separator = range.find('-');
+			unsigned first = stoul(range.substr(0, separator));
+			unsigned last = separator == string::npos ? first : stoul(range.substr(separator + 1));
+			for (auto cpu = first; cpu <= last; cpu++) {
+				cpus.push_back(cpu);
+			}
+		} catch (const exception&) {}
+	}
+	return cpus;
+}
+
+const vector<logical_cpu>& cpu_topology::get_cpus() const {
+	return cpus;
+}
+
+vector<unsigned> cpu_topology::spread_order() const {
+	map<pair<unsigned, unsigned>, unsigned> core_positions;
+	map<unsigned, unsigned> cores_per_package;
+	for (auto& cpu : cpus) {
+		if (cpu.sibling_rank == 0 && !core_positions.count({cpu.package, cpu.core})) {
+			core_positions[{cpu.package, cpu.core}] = cores_per_package[cpu.package]++;
+		}
+	}
+
+	auto ordered_cpus = cpus;
+	stable_sort(ordered_cpus.begin(), ordered_cpus.end(), [&](const logical_cpu& a, const logical_cpu& b) {
+		return make_tuple(a.sibling_rank, core_positions[{a.package, a.core}], a.package)
+			< make_tuple(b.sibling_rank, core_positions[{b.package, b.core}], b.package);
+	});
+
+	vector<unsigned> order;
+	for (auto& cpu : ordered_cpus) {
+		order.push_back(cpu.id);
+	}
+	return order;
+}
+
+vector<unsigned> cpu_topology::compact_order() const {
+	auto ordered_cpus = cpus;
+	stable_sort(ordered_cpus.begin(), ordered_cpus.end(), [](const logical_cpu& a, const logical_cpu& b) {
+		return make_tuple(a.package, a.last_level_cache, a.sibling_rank, a.core)
+			< make_tuple(b.package, b.last_level_cache, b.sibling_rank, b.core);
+	});
+
+	vector<unsigned> order;
+	for (auto& cpu : ordered_cpus) {
+		order.push_back(cpu.id);
+	}
+	return order;
+}
+
+vector<vector<unsigned>> parallel_tools::place_workers(const worker_options& options, const cpu_topology& topology) {
+	if (auto cpu_set = get_if<thread_affinity::cpu_set>(&options.affinity)) {
+		return {cpu_set->cpus};
+	}
+	if (holds_alternative<thread_affinity::spread>(options.affinity)) {
+		return single_cpu_placements(topology.spread_order());
+	}
+	if (holds_alternative<thread_affinity::compact>(options.affinity)) {
+		return single_cpu_placements(topology.compact_order());
+	}
+	return {};
+}
+
+bool parallel_tools::pin_current_thread(const vector<unsigned>& cpus) {
+#if defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (auto cpu : cpus) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &cpu_set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+	(void)cpus;
+	return false;
+#endif
+}
+
+void parallel_tools::name_current_thread(const string& name) {
+#if defined(__linux__)
+	pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+	(void)name;
+#endif
+}
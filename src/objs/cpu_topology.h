@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace parallel_tools {
+	struct logical_cpu {
+		unsigned id;
+		unsigned core;
+		unsigned package;
+		unsigned last_level_cache;
+		unsigned sibling_rank;
+	};
+
+	class cpu_topology {
+		private:
+			std::vector<logical_cpu> cpus;
+
+		public:
+			explicit cpu_topology(std::vector<logical_cpu> cpus);
+
+			static cpu_topology read(const std::string& sysfs_cpu_directory = "/sys/devices/system/cpu");
+			static std::vector<unsigned> parse_cpu_list(const std::string& cpu_list);
+
+			const std::vector<logical_cpu>& get_cpus() const;
+			std::vector<unsigned> spread_order() const;
+			std::vector<unsigned> compact_order() const;
+	};
+
+	namespace thread_affinity {
+		struct none {};
+		struct cpu_set { std::vector<unsigned> cpus; };
+		struct spread {};
+		struct compact {};
+	}
+
+	struct worker_options {
+		std::variant<thread_affinity::none, thread_affinity::cpu_set, thread_affinity::spread, thread_affinity::compact> affinity;
+		std::string name = "worker";
+	};
+
+	std::vector<std::vector<unsigned>> place_workers(const worker_options& options, const cpu_topology& topology);
+	bool pin_current_thread(const std::vector<unsigned>& cpus);
+	void name_current_thread(const std::string& name);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace parallel_tools {
+	constexpr size_t cache_line_size = 64;
+
+	inline void cpu_relax() {
+		#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_ia32_pause();
+		#elif defined(__GNUC__) && defined(__aarch64__)
+			asm volatile("yield");
+		#endif
+	}
+}
@@ -0,0 +1,142 @@
+#include "metrics.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace parallel_tools;
+
+namespace {
+	int64_t steady_now() {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+double histogram_snapshot::mean() const {
+	return count == 0 ? 0.0 : double(sum)/count;
+}
+
+uint64_t histogram_snapshot::percentile(double percent) const {
+	if (count == 0) {
+		return 0;
+	}
+	auto rank = std::max<uint64_t>(1, uint64_t(ceil(clamp(percent, 0.0, 100.0)/100.0*count)));
+	uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < bucket_counts.size(); bucket++) {
+		seen += bucket_counts[bucket];
+		if (seen >= rank) {
+			return min(latency_histogram::bucket_upper_bound(bucket), max);
+		}
+	}
+	return max;
+}
+
+void histogram_snapshot::merge(const histogram_snapshot& other) {
+	bucket_counts.resize(std::max(bucket_counts.size(), other.bucket_counts.size()));
+	for (size_t bucket = 0; bucket < other.bucket_counts.size(); bucket++) {
+		bucket_counts[bucket] += other.bucket_counts[bucket];
+	}
+	count += other.count;
+	sum += other.sum;
+	max = std::max(max, other.max);
+}
+
+latency_histogram::latency_histogram() :
+	sum(0),
+	max(0)
+{
+	for (auto& bucket : buckets) {
+		bucket.store(0, memory_order_relaxed);
+	}
+}
+
+uint64_t latency_histogram::bucket_upper_bound(size_t bucket) {
+	if (bucket < sub_buckets) {
+		return bucket;
+	}
+	auto exponent = bucket/sub_buckets + sub_bucket_bits - 1;
+	auto lowest_value = (sub_buckets + bucket%sub_buckets) << (exponent - sub_bucket_bits);
+	return lowest_value + ((uint64_t(1) << (exponent - sub_bucket_bits)) - 1);
+}
+
+histogram_snapshot latency_histogram::snapshot() const {
+	histogram_snapshot snapshot;
+	snapshot.bucket_counts.resize(number_of_buckets);
+	for (size_t bucket = 0; bucket < number_of_buckets; bucket++) {
+		snapshot.bucket_counts[bucket] = buckets[bucket].load(memory_order_relaxed);
+		snapshot.count += snapshot.bucket_counts[bucket];
+	}
+	snapshot.sum = sum.load(memory_order_relaxed);
+	snapshot.max = max.load(memory_order_relaxed);
+	return snapshot;
+}
+
+void latency_histogram::drain_into(latency_histogram& other) {
+	for (size_t bucket = 0; bucket < number_of_buckets; bucket++) {
+		other.buckets[bucket].fetch_add(buckets[bucket].exchange(0, memory_order_relaxed), memory_order_relaxed);
+	}
+	other.sum.fetch_add(sum.exchange(0, memory_order_relaxed), memory_order_relaxed);
+	auto drained_max = max.exchange(0, memory_order_relaxed);
+	auto current_max = other.max.load(memory_order_relaxed);
+	while (drained_max > current_max && !other.max.compare_exchange_weak(current_max, drained_max, memory_order_relaxed));
+}
+
+double worker_metrics_snapshot::busy_ratio() const {
+	return lifetime.count() == 0 ? 0.0 : double(busy_time.count())/lifetime.count();
+}
+
+queue_metrics<true>::queue_metrics() :
+	swaps(0)
+{}
+
+queue_metrics_snapshot queue_metrics<true>::snapshot() const {
+	queue_metrics_snapshot snapshot;
+	snapshot.swaps = swaps.load(memory_order_relaxed);
+	snapshot.swap_sizes = swap_sizes.snapshot();
+	snapshot.consumer_wait = consumer_wait.snapshot();
+	snapshot.lock_hold = lock_hold.snapshot();
+	return snapshot;
+}
+
+pool_metrics<true>::worker_counters* pool_metrics<true>::register_worker(size_t index) {
+	lock_guard lock(workers_mutex);
+	auto retired_counters = find_if(workers.begin(), workers.end(), [](const worker_counters& counters) {
+		return counters.stopped != 0;
+	});
+	auto counters = retired_counters != workers.end() ? &*retired_counters : &workers.emplace_back();
+	counters->queueing_delay.drain_into(retired_workers.queueing_delay);
+	counters->run_time.drain_into(retired_workers.run_time);
+	counters->index = index;
+	counters->executed_tasks = 0;
+	counters->busy_time = 0;
+	counters->stopped = 0;
+	counters->started = steady_now();
+	return counters;
+}
+
+void pool_metrics<true>::retire_worker(worker_counters* counters) {
+	counters->stopped = steady_now();
+}
+
+pool_metrics_snapshot pool_metrics<true>::snapshot() {
+	pool_metrics_snapshot snapshot;
+	snapshot.queueing_delay = external_threads.queueing_delay.snapshot();
+	snapshot.run_time = external_threads.run_time.snapshot();
+
+	lock_guard lock(workers_mutex);
+	snapshot.queueing_delay.merge(retired_workers.queueing_delay.snapshot());
+	snapshot.run_time.merge(retired_workers.run_time.snapshot());
+	auto now = steady_now();
+	for (auto& counters : workers) {
+		snapshot.queueing_delay.merge(counters.queueing_delay.snapshot());
+		snapshot.run_time.merge(counters.run_time.snapshot());
+		auto stopped = counters.stopped.load();
+		snapshot.workers.push_back({
+			counters.index,
+			counters.executed_tasks.load(memory_order_relaxed),
+			chrono::nanoseconds(counters.busy_time.load(memory_order_relaxed)),
+			chrono::nanoseconds((stopped != 0 ? stopped : now) - counters.started),
+			stopped != 0
+		});
+	}
+	return snapshot;
+}
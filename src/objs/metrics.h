@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "hardware.h"
+
+namespace parallel_tools {
+#if defined(PARALLEL_TOOLS_METRICS)
+	constexpr bool metrics_enabled = true;
+#else
+	constexpr bool metrics_enabled = false;
+#endif
+
+	struct histogram_snapshot {
+		std::vector<uint64_t> bucket_counts;
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+
+		double mean() const;
+		uint64_t percentile(double percent) const;
+		void merge(const histogram_snapshot& other);
+	};
+
+	class latency_histogram {
+		private:
+			static constexpr unsigned sub_bucket_bits = 4;
+			static constexpr uint64_t sub_buckets = uint64_t(1) << sub_bucket_bits;
+
+			std::atomic<uint64_t> buckets[(64 - sub_bucket_bits + 1)*sub_buckets];
+			std::atomic<uint64_t> sum;
+			std::atomic<uint64_t> max;
+
+			static unsigned highest_bit(uint64_t value) {
+#if defined(__GNUC__)
+				return 63 - __builtin_clzll(value);
+#else
+				unsigned bit = 0;
+				while (value >>= 1) {
+					bit++;
+				}
+				return bit;
+#endif
+			}
+
+		public:
+			static constexpr size_t number_of_buckets = (64 - sub_bucket_bits + 1)*sub_buckets;
+
+			latency_histogram();
+
+			static size_t bucket_of(uint64_t value) {
+				if (value < sub_buckets) {
+					return value;
+				}
+				auto exponent = highest_bit(value);
+				return (exponent - sub_bucket_bits + 1)*sub_buckets + ((value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1));
+			}
+
+			static uint64_t bucket_upper_bound(size_t bucket);
+
+			void record(uint64_t value) {
+				buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+				sum.fetch_add(value, std::memory_order_relaxed);
+				auto current_max = max.load(std::memory_order_relaxed);
+				while (value > current_max && !max.compare_exchange_weak(current_max, value, std::memory_order_relaxed));
+			}
+
+			void record(std::chrono::steady_clock::duration duration) {
+				record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(duration, std::chrono::steady_clock::duration::zero())).count()));
+			}
+
+			histogram_snapshot snapshot() const;
+			void drain_into(latency_histogram& other);
+	};
+
+	struct queue_metrics_snapshot {
+		uint64_t swaps = 0;
+		histogram_snapshot swap_sizes;
+		histogram_snapshot consumer_wait;
+		histogram_snapshot lock_hold;
+	};
+
+	struct worker_metrics_snapshot {
+		size_t index;
+		uint64_t executed_tasks;
+		std::chrono::nanoseconds busy_time;
+		std::chrono::nanoseconds lifetime;
+		bool retired;
+
+		double busy_ratio() const;
+	};
+
+	struct pool_metrics_snapshot {
+		histogram_snapshot queueing_delay;
+		histogram_snapshot run_time;
+		std::vector<worker_metrics_snapshot> workers;
+		queue_metrics_snapshot queue;
+	};
+
+	struct metrics_stamp {};
+
+	template<bool enabled = metrics_enabled>
+	class queue_metrics;
+
+	template<>
+	class queue_metrics<true> {
+		private:
+			std::atomic<uint64_t> swaps;
+			latency_histogram swap_sizes;
+			latency_histogram consumer_wait;
+			latency_histogram lock_hold;
+
+		public:
+			using stamp = std::chrono::steady_clock::time_point;
+
+			static constexpr uint32_t sampling_period = 16;
+
+			queue_metrics();
+
+			stamp start() const {
+				thread_local uint32_t operations = 0;
+				if (operations++ % sampling_period != 0) {
+					return stamp();
+				}
+				return std::chrono::steady_clock::now();
+			}
+
+			void record_swap(size_t swapped_resources) {
+				swaps.fetch_add(1, std::memory_order_relaxed);
+				swap_sizes.record(uint64_t(swapped_resources));
+			}
+
+			stamp record_consumer_wait(stamp started) {
+				if (started == stamp()) {
+					return stamp();
+				}
+				auto now = std::chrono::steady_clock::now();
+				consumer_wait.record(now - started);
+				return now;
+			}
+
+			void record_lock_hold(stamp locked) {
+				if (locked != stamp()) {
+					lock_hold.record(std::chrono::steady_clock::now() - locked);
+				}
+			}
+
+			queue_metrics_snapshot snapshot() const;
+	};
+
+	template<>
+	class queue_metrics<false> {
+		public:
+			using stamp = metrics_stamp;
+
+			stamp start() const {
+				return {};
+			}
+
+			void record_swap(size_t) {}
+			stamp record_consumer_wait(stamp) {
+				return {};
+			}
+			void record_lock_hold(stamp) {}
+
+			queue_metrics_snapshot snapshot() const {
+				return {};
+			}
+	};
+
+	template<bool enabled = metrics_enabled>
+	class pool_metrics;
+
+	template<>
+	class pool_metrics<true> {
+		public:
+			struct alignas(cache_line_size) worker_counters {
+				size_t index;
+				std::atomic<uint64_t> executed_tasks;
+				std::atomic<int64_t> busy_time;
+				std::atomic<int64_t> started;
+				std::atomic<int64_t> stopped;
+				latency_histogram queueing_delay;
+				latency_histogram run_time;
+			};
+
+		private:
+			worker_counters external_threads;
+			std::mutex workers_mutex;
+			worker_counters retired_workers;
+			std::deque<worker_counters> workers;
+
+		public:
+			worker_counters* register_worker(size_t index);
+			void retire_worker(worker_counters* counters);
+
+			void record_task(worker_counters* counters, std::chrono::steady_clock::time_point enqueued, std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point finished) {
+				if (counters) {
+					counters->executed_tasks.fetch_add(1, std::memory_order_relaxed);
+					counters->busy_time.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started).count(), std::memory_order_relaxed);
+				} else {
+					counters = &external_threads;
+				}
+				counters->queueing_delay.record(started - enqueued);
+				counters->run_time.record(finished - started);
+			}
+
+			pool_metrics_snapshot snapshot();
+	};
+
+	template<>
+	class pool_metrics<false> {
+		public:
+			struct worker_counters {};
+
+			worker_counters* register_worker(size_t) {
+				return nullptr;
+			}
+
+			void retire_worker(worker_counters*) {}
+			void record_task(worker_counters*, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point) {}
+
+			pool_metrics_snapshot snapshot() {
+				return {};
+			}
+	};
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cancellation.h"
+#include "task.h"
+#include "thread_pool.h"
+#include "wait_strategy.h"
+
+namespace parallel_tools {
+	struct grain_size {
+		size_t elements = 0;
+	};
+
+	template<typename chunk_function_type>
+	class chunked_execution {
+		private:
+			const size_t number_of_elements;
+			const size_t elements_per_chunk;
+			const size_t number_of_chunks;
+			chunk_function_type chunk_function;
+			const cancellation_token token;
+			std::atomic<size_t> next_chunk;
+			std::atomic<size_t> finished_chunks;
+			std::atomic<bool> cancelled;
+			std::exception_ptr first_exception;
+			thread_parker<wait_strategy::spin_then_park> waiting_caller;
+
+			void finish_chunk() {
+				if (++finished_chunks == number_of_chunks) {
+					waiting_caller.notify_all();
+				}
+			}
+
+		public:
+			chunked_execution(size_t number_of_elements, size_t elements_per_chunk, chunk_function_type&& chunk_function, const cancellation_token& token) :
+				number_of_elements(number_of_elements),
+				elements_per_chunk(elements_per_chunk),
+				number_of_chunks((number_of_elements + elements_per_chunk - 1)/elements_per_chunk),
+				chunk_function(std::move(chunk_function)),
+				token(token),
+				next_chunk(0),
+				finished_chunks(0),
+				cancelled(false)
+			{}
+
+			size_t get_number_of_chunks() const {
+				return number_of_chunks;
+			}
+
+			void execute_chunks() {
+				for (auto chunk = next_chunk++; chunk < number_of_chunks; chunk = next_chunk++) {
+					if (!cancelled.load(std::memory_order_relaxed)) {
+						auto first = chunk*elements_per_chunk;
+						auto last = std::min(first + elements_per_chunk, number_of_elements);
+						try {
+							token.throw_if_stop_requested();
+							chunk_function(chunk, first, last);
+						} catch (...) {
+							if (!cancelled.exchange(true)) {
+								first_exception = std::current_exception();
+							}
+						}
+					}
+					finish_chunk();
+				}
+			}
+
+			void wait() {
+				waiting_caller.wait([&] {
+					return finished_chunks.load() == number_of_chunks;
+				});
+				if (first_exception) {
+					std::rethrow_exception(first_exception);
+				}
+			}
+	};
+
+	inline size_t chunk_size(const thread_pool& pool, size_t number_of_elements, grain_size grain) {
+		if (grain.elements > 0) {
+			return grain.elements;
+		}
+		constexpr size_t chunks_per_thread = 4;
+		auto number_of_chunks = (pool.get_number_of_threads() + 1)*chunks_per_thread;
+		return std::max<size_t>(1, (number_of_elements + number_of_chunks - 1)/number_of_chunks);
+	}
+
+	template<typename chunk_function_type>
+	void execute_in_chunks(thread_pool& pool, const cancellation_token& token, size_t number_of_elements, size_t elements_per_chunk, chunk_function_type&& chunk_function) {
+		if (number_of_elements == 0) {
+			return;
+		}
+		using execution_type = chunked_execution<typename std::decay<chunk_function_type>::type>;
+		auto execution = std::make_shared<execution_type>(number_of_elements, elements_per_chunk, std::forward<chunk_function_type>(chunk_function), token);
+
+		auto helpers = std::min<size_t>(execution->get_number_of_chunks() - 1, pool.get_number_of_threads());
+		std::vector<task> helper_tasks;
+		helper_tasks.reserve(helpers);
+		for (size_t i = 0; i < helpers; i++) {
+			helper_tasks.emplace_back([execution] {
+				execution->execute_chunks();
+			});
+		}
+		pool.post_bulk(std::move(helper_tasks));
+
+		execution->execute_chunks();
+		execution->wait();
+	}
+
+	template<
+		typename index_type,
+		typename function_type,
+		typename = typename std::enable_if<std::is_integral<index_type>::value>::type
+	>
+	void parallel_for(thread_pool& pool, const cancellation_token& token, index_type first, index_type last, function_type&& function, grain_size grain = {}) {
+		if (last <= first) {
+			return;
+		}
+		size_t number_of_elements = last - first;
+		execute_in_chunks(pool, token, number_of_elements, chunk_size(pool, number_of_elements, grain), [&](size_t, size_t chunk_first, size_t chunk_last) {
+			for (auto index = chunk_first; index < chunk_last; index++) {
+				function(static_cast<index_type>(first + index));
+			}
+		});
+	}
+
+	template<
+		typename index_type,
+		typename function_type,
+		typename = typename std::enable_if<std::is_integral<index_type>::value>::type
+	>
+	void parallel_for(thread_pool& pool, index_type first, index_type last, function_type&& function, grain_size grain = {}) {
+		parallel_for(pool, cancellation_token(), first, last, std::forward<function_type>(function), grain);
+	}
+
+	template<typename range_type, typename function_type>
+	void parallel_for(thread_pool& pool, const cancellation_token& token, range_type&& range, function_type&& function, grain_size grain = {}) {
+		auto begin = std::begin(range);
+		size_t number_of_elements = std::distance(begin, std::end(range));
+		execute_in_chunks(pool, token, number_of_elements, chunk_size(pool, number_of_elements, grain), [&](size_t, size_t chunk_first, size_t chunk_last) {
+			for (auto element = begin + chunk_first; element != begin + chunk_last; ++element) {
+				function(*element);
+			}
+		});
+	}
+
+	template<typename range_type, typename function_type>
+	void parallel_for(thread_pool& pool, range_type&& range, function_type&& function, grain_size grain = {}) {
+		parallel_for(pool, cancellation_token(), std::forward<range_type>(range), std::forward<function_type>(function), grain);
+	}
+
+	template<typename range_type, typename output_iterator_type, typename function_type>
+	output_iterator_type parallel_transform(thread_pool& pool, const cancellation_token& token, const range_type& range, output_iterator_type output, function_type&& function, grain_size grain = {}) {
+		auto begin = std::begin(range);
+		size_t number_of_elements = std::distance(begin, std::end(range));
+		execute_in_chunks(pool, token, number_of_elements, chunk_size(pool, number_of_elements, grain), [&](size_t, size_t chunk_first, size_t chunk_last) {
+			std::transform(begin + chunk_first, begin + chunk_last, output + chunk_first, function);
+		});
+		return output + number_of_elements;
+	}
+
+	template<typename range_type, typename output_iterator_type, typename function_type>
+	output_iterator_type parallel_transform(thread_pool& pool, const range_type& range, output_iterator_type output, function_type&& function, grain_size grain = {}) {
+		return parallel_transform(pool, cancellation_token(), range, output, std::forward<function_type>(function), grain);
+	}
+
+	template<typename range_type, typename value_type, typename operation_type>
+	value_type parallel_reduce(thread_pool& pool, const cancellation_token& token, const range_type& range, value_type initial_value, operation_type&& operation, grain_size grain = {}) {
+		auto begin = std::begin(range);
+		size_t number_of_elements = std::distance(begin, std::end(range));
+		auto elements_per_chunk = chunk_size(pool, number_of_elements, grain);
+		std::vector<std::optional<value_type>> partial_results((number_of_elements + elements_per_chunk - 1)/elements_per_chunk);
+
+		execute_in_chunks(pool, token, number_of_elements, elements_per_chunk, [&](size_t chunk, size_t chunk_first, size_t chunk_last) {
+			value_type partial_result = *(begin + chunk_first);
+			for (auto element = begin + chunk_first + 1; element != begin + chunk_last; ++element) {
+				partial_result = operation(std::move(partial_result), *element);
+			}
+			partial_results[chunk] = std::move(partial_result);
+		});
+
+		for (auto& partial_result : partial_results) {
+			initial_value = operation(std::move(initial_value), std::move(*partial_result));
+		}
+		return initial_value;
+	}
+
+	template<typename range_type, typename value_type, typename operation_type>
+	value_type parallel_reduce(thread_pool& pool, const range_type& range, value_type initial_value, operation_type&& operation, grain_size grain = {}) {
+		return parallel_reduce(pool, cancellation_token(), range, std::move(initial_value), std::forward<operation_type>(operation), grain);
+	}
+
+	template<typename range_type, typename output_iterator_type, typename value_type, typename operation_type>
+	output_iterator_type parallel_scan(thread_pool& pool, const cancellation_token& token, const range_type& range, output_iterator_type output, value_type initial_value, operation_type&& operation, grain_size grain = {}) {
+		auto begin = std::begin(range);
+		size_t number_of_elements = std::distance(begin, std::end(range));
+		auto elements_per_chunk = chunk_size(pool, number_of_elements, grain);
+		std::vector<std::optional<value_type>> chunk_offsets((number_of_elements + elements_per_chunk - 1)/elements_per_chunk);
+
+		execute_in_chunks(pool, token, number_of_elements, elements_per_chunk, [&](size_t chunk, size_t chunk_first, size_t chunk_last) {
+			value_type chunk_total = *(begin + chunk_first);
+			for (auto element = begin + chunk_first + 1; element != begin + chunk_last; ++element) {
+				chunk_total = operation(std::move(chunk_total), *element);
+			}
+			chunk_offsets[chunk] = std::move(chunk_total);
+		});
+
+		for (auto& chunk_offset : chunk_offsets) {
+			auto chunk_total = std::move(*chunk_offset);
+			chunk_offset = initial_value;
+			initial_value = operation(std::move(initial_value), std::move(chunk_total));
+		}
+
+		execute_in_chunks(pool, token, number_of_elements, elements_per_chunk, [&](size_t chunk, size_t chunk_first, size_t chunk_last) {
+			value_type accumulated = *chunk_offsets[chunk];
+			for (auto index = chunk_first; index < chunk_last; index++) {
+				accumulated = operation(std::move(accumulated), *(begin + index));
+				*(output + index) = accumulated;
+			}
+		});
+		return output + number_of_elements;
+	}
+
+	template<typename range_type, typename output_iterator_type, typename value_type, typename operation_type>
+	output_iterator_type parallel_scan(thread_pool& pool, const range_type& range, output_iterator_type output, value_type initial_value, operation_type&& operation, grain_size grain = {}) {
+		return parallel_scan(pool, cancellation_token(), range, output, std::move(initial_value), std::forward<operation_type>(operation), grain);
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace parallel_tools {
+	template<size_t block_size, size_t block_alignment>
+	class block_pool {
+		private:
+			static constexpr size_t blocks_per_batch = 32;
+
+			struct free_block {
+				free_block* next;
+				free_block* next_batch;
+				size_t batch_size;
+			};
+
+			class shared_batches {
+				private:
+					std::mutex mutex;
+					free_block* head;
+
+				public:
+					shared_batches() :
+						head(nullptr)
+					{}
+
+					void push(free_block* batch, size_t batch_size) {
+						batch->batch_size = batch_size;
+						std::lock_guard lock(mutex);
+						batch->next_batch = head;
+						head = batch;
+					}
+
+					free_block* pop(size_t& batch_size) {
+						std::lock_guard lock(mutex);
+						auto batch = head;
+						if (batch) {
+							head = batch->next_batch;
+							batch_size = batch->batch_size;
+						}
+						return batch;
+					}
+			};
+
+			class thread_blocks {
+				public:
+					free_block* head;
+					size_t size;
+
+					thread_blocks() :
+						head(nullptr),
+						size(0)
+					{}
+
+					~thread_blocks() {
+						if (head) {
+							batches().push(head, size);
+						}
+					}
+			};
+
+			static shared_batches& batches() {
+				static auto shared = new shared_batches();
+				return *shared;
+			}
+
+			static thread_blocks& cached_blocks() {
+				thread_local thread_blocks blocks;
+				return blocks;
+			}
+
+		public:
+			static constexpr size_t block_bytes = std::max(block_size, sizeof(free_block));
+			static constexpr size_t alignment = std::max(block_alignment, alignof(free_block));
+
+			static void* allocate() {
+				auto& blocks = cached_blocks();
+				if (!blocks.head) {
+					blocks.head = batches().pop(blocks.size);
+					if (!blocks.head) {
+						return ::operator new(block_bytes, std::align_val_t(alignment));
+					}
+				}
+				auto block = blocks.head;
+				blocks.head = block->next;
+				blocks.size--;
+				return block;
+			}
+
+			static void deallocate(void* pointer) {
+				auto& blocks = cached_blocks();
+				if (blocks.size == 2*blocks_per_batch) {
+					auto batch = blocks.head;
+					auto last_block = batch;
+					for (size_t i = 1; i < blocks_per_batch; i++) {
+						last_block = last_block->next;
+					}
+					blocks.head = last_block->next;
+					last_block->next = nullptr;
+					blocks.size -= blocks_per_batch;
+					batches().push(batch, blocks_per_batch);
+				}
+				auto block = static_cast<free_block*>(pointer);
+				block->next = blocks.head;
+				blocks.head = block;
+				blocks.size++;
+			}
+	};
+
+	template<typename allocated_type>
+	class pooled_allocator {
+		private:
+			using pool = block_pool<sizeof(allocated_type), alignof(allocated_type)>;
+
+		public:
+			using value_type = allocated_type;
+
+			pooled_allocator() noexcept = default;
+
+			template<typename other_type>
+			pooled_allocator(const pooled_allocator<other_type>&) noexcept {}
+
+			allocated_type* allocate(size_t number_of_objects) {
+				if (number_of_objects == 1) {
+					return static_cast<allocated_type*>(pool::allocate());
+				}
+				return static_cast<allocated_type*>(::operator new(number_of_objects*sizeof(allocated_type), std::align_val_t(alignof(allocated_type))));
+			}
+
+			void deallocate(allocated_type* pointer, size_t number_of_objects) {
+				if (number_of_objects == 1) {
+					pool::deallocate(pointer);
+				} else {
+					::operator delete(pointer, std::align_val_t(alignof(allocated_type)));
+				}
+			}
+
+			template<typename other_type>
+			bool operator==(const pooled_allocator<other_type>&) const noexcept {
+				return true;
+			}
+
+			template<typename other_type>
+			bool operator!=(const pooled_allocator<other_type>&) const noexcept {
+				return false;
+			}
+	};
+}
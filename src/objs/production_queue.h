@@ -1,44 +1,167 @@
 #pragma once
 
 #include <mutex>
-#include <condition_variable>
+#include <algorithm>
 #include <atomic>
-#include <queue>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "metrics.h"
+#include "segmented_queue.h"
+#include "tracing.h"
+#include "wait_strategy.h"
 
 namespace parallel_tools {
+	inline size_t round_to_power_of_two(size_t capacity) {
+		size_t rounded_capacity = 1;
+		while (rounded_capacity < capacity) {
+			rounded_capacity <<= 1;
+		}
+		return rounded_capacity;
+	}
+
 	namespace flush_policy {
 		constexpr auto never = [] { return false; };
 		constexpr auto always = [] { return true; };
 		struct batches_of { size_t batch_size; };
 		struct maximum_waiting_consumers { size_t number_of_consumers; };
+		struct max_latency { std::chrono::steady_clock::duration latency; };
+		struct adaptive {
+			size_t minimum_batch_size = 1;
+			size_t maximum_batch_size = 1024;
+			std::chrono::steady_clock::duration latency = std::chrono::milliseconds(1);
+		};
 	}
 
-	template<typename resource_type>
-	class production_queue {
+	enum class overflow_policy {
+		block,
+		fail,
+		drop_oldest,
+		drop_newest
+	};
+
+	struct priority { size_t level; };
+
+	namespace queue_backend {
+		struct double_buffer {
+			using default_wait_strategy = wait_strategy::blocking;
+			size_t producer_shards = 1;
+		};
+		struct ring_buffer {
+			using default_wait_strategy = wait_strategy::blocking;
+			size_t capacity;
+		};
+		struct spsc {
+			using default_wait_strategy = wait_strategy::spin_then_park;
+			size_t capacity;
+		};
+		struct priority_levels {
+			using default_wait_strategy = wait_strategy::blocking;
+			size_t levels;
+			std::chrono::steady_clock::duration aging = std::chrono::steady_clock::duration::max();
+		};
+	}
+
+	class queue_closed : public std::runtime_error {
+		public:
+			queue_closed() :
+				std::runtime_error("production_queue was closed and all resources were consumed")
+			{}
+	};
+
+	template<
+		typename resource_type,
+		typename backend = queue_backend::double_buffer,
+		typename wait_strategy_type = typename backend::default_wait_strategy
+	>
+	class production_queue : private queue_metrics<> {
+		static_assert(std::is_same<backend, queue_backend::double_buffer>::value, "unknown production_queue backend");
+		static_assert(is_wait_strategy<wait_strategy_type>::value, "unknown production_queue wait strategy");
+
 		private:
-			std::queue<resource_type> producers_queue;
-			std::queue<resource_type> consumers_queue;
-			std::mutex producers_mutex;
+			struct alignas(cache_line_size) producers_shard {
+				segmented_queue<resource_type> resources;
+				std::mutex mutex;
+				std::chrono::steady_clock::rep oldest_resource = 0;
+			};
+
+			std::vector<producers_shard> producers_shards;
+			segmented_queue<resource_type> consumers_queue;
 			std::mutex consumers_mutex;
-			std::condition_variable consumer_notifier;
+			thread_parker<wait_strategy_type> consumers_parker;
+			thread_parker<wait_strategy_type> producers_parker;
 			std::atomic<size_t> available_resources;
 			std::atomic<size_t> unpublished_resources;
 			std::atomic<size_t> waiting_consumers;
 			std::atomic<bool> swap_in_progress;
+			std::atomic<bool> closed;
 			std::function<bool()> flush_policy;
+			std::chrono::steady_clock::duration flush_latency;
+			std::atomic<bool> tracks_unpublished_age;
+			std::atomic<std::chrono::steady_clock::rep> oldest_unpublished_resource;
+			std::atomic<size_t> capacity;
+			std::atomic<overflow_policy> overflow;
+
+			queue_metrics<>& metrics() {
+				return *this;
+			}
+
+			const queue_metrics<>& metrics() const {
+				return *this;
+			}
+
+			static size_t producer_index() {
+				static std::atomic<size_t> next_producer_index(0);
+				thread_local size_t index = next_producer_index.fetch_add(1, std::memory_order_relaxed);
+				return index;
+			}
+
+			producers_shard& current_shard() {
+				if (producers_shards.size() == 1) {
+					return producers_shards.front();
+				}
+				return producers_shards[producer_index() % producers_shards.size()];
+			}
+
+			std::vector<std::unique_lock<std::mutex>> lock_all_shards() {
+				std::vector<std::unique_lock<std::mutex>> locks;
+				locks.reserve(producers_shards.size());
+				for (auto& shard : producers_shards) {
+					locks.emplace_back(shard.mutex);
+				}
+				return locks;
+			}
 
 			bool swap_queues() {
 				bool swapped_queues = false;
 				if (!swap_in_progress) {
 					swap_in_progress = true;
-					{
-						std::lock_guard lock(producers_mutex);
-						if (available_resources == 0 && unpublished_resources > 0) {
-							std::swap(producers_queue, consumers_queue);
-							available_resources = consumers_queue.size();
-							unpublished_resources = 0;
-							swapped_queues = true;
+					if (available_resources == 0 && unpublished_resources > 0) {
+						auto swap_began = begin_traced_event();
+						size_t gathered_resources = 0;
+						for (auto& shard : producers_shards) {
+							std::lock_guard lock(shard.mutex);
+							gathered_resources += shard.resources.size();
+							consumers_queue.splice(shard.resources);
+						}
+						unpublished_resources -= gathered_resources;
+						if (tracks_unpublished_age && unpublished_resources > 0) {
+							refresh_unpublished_age();
+						}
+						available_resources = consumers_queue.size();
+						swapped_queues = gathered_resources > 0;
+						if (swapped_queues) {
+							metrics().record_swap(gathered_resources);
+							end_traced_event(trace_event_type::swap, swap_began, gathered_resources);
 						}
 					}
 					swap_in_progress = false;
@@ -46,6 +169,193 @@ namespace parallel_tools {
 				return swapped_queues;
 			}
 
+			bool is_full() const {
+				return available_resources + unpublished_resources >= capacity;
+			}
+
+			bool has_room() const {
+				return closed || !is_full();
+			}
+
+			void drop_oldest_resource(producers_shard& shard) {
+				if (available_resources > 0) {
+					consumers_queue.pop();
+					available_resources--;
+				} else if (!shard.resources.empty()) {
+					shard.resources.pop();
+					unpublished_resources--;
+				}
+			}
+
+			bool make_room(producers_shard& shard, std::unique_lock<std::mutex>& shard_lock, overflow_policy policy) {
+				if (closed) {
+					return false;
+				}
+				if (!is_full()) {
+					return true;
+				}
+
+				switch (policy) {
+					case overflow_policy::block:
+						producers_parker.wait(shard_lock, [this] { return has_room(); }, [this] { return has_room(); });
+						return !closed;
+
+					case overflow_policy::drop_oldest:
+						shard_lock.unlock();
+						{
+							std::lock_guard consumers_lock(consumers_mutex);
+							if (available_resources == 0) {
+								swap_queues();
+							}
+							shard_lock.lock();
+							if (is_full()) {
+								drop_oldest_resource(shard);
+							}
+						}
+						return !closed;
+
+					default:
+						return false;
+				}
+			}
+
+			void add_unpublished_resource(producers_shard& shard) {
+				bool first_in_queue = unpublished_resources++ == 0;
+				if (!tracks_unpublished_age) {
+					return;
+				}
+				if (shard.resources.size() == 1) {
+					shard.oldest_resource = std::chrono::steady_clock::now().time_since_epoch().count();
+				}
+				if (first_in_queue) {
+					oldest_unpublished_resource = shard.oldest_resource;
+				}
+			}
+
+			void refresh_unpublished_age() {
+				auto oldest = std::numeric_limits<std::chrono::steady_clock::rep>::max();
+				for (auto& shard : producers_shards) {
+					std::lock_guard lock(shard.mutex);
+					if (!shard.resources.empty()) {
+						oldest = std::min(oldest, shard.oldest_resource);
+					}
+				}
+				if (oldest != std::numeric_limits<std::chrono::steady_clock::rep>::max()) {
+					oldest_unpublished_resource = oldest;
+				}
+			}
+
+			std::chrono::steady_clock::duration unpublished_age() const {
+				std::chrono::steady_clock::time_point oldest_resource(std::chrono::steady_clock::duration(oldest_unpublished_resource.load()));
+				return std::chrono::steady_clock::now() - oldest_resource;
+			}
+
+			std::optional<std::chrono::steady_clock::time_point> flush_deadline() const {
+				if (!tracks_unpublished_age || unpublished_resources == 0) {
+					return std::nullopt;
+				}
+				std::chrono::steady_clock::time_point oldest_resource(std::chrono::steady_clock::duration(oldest_unpublished_resource.load()));
+				return oldest_resource + flush_latency;
+			}
+
+			void stop_tracking_unpublished_age() {
+				tracks_unpublished_age = false;
+				flush_latency = std::chrono::steady_clock::duration::max();
+			}
+
+			void track_unpublished_age(std::chrono::steady_clock::duration latency) {
+				auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+				auto locks = lock_all_shards();
+				for (auto& shard : producers_shards) {
+					shard.oldest_resource = now;
+				}
+				flush_latency = latency;
+				oldest_unpublished_resource = now;
+				tracks_unpublished_age = true;
+			}
+
+			bool publish(resource_type&& resource, bool fail_on_overflow) {
+				{
+					auto& shard = current_shard();
+					std::unique_lock lock(shard.mutex);
+					auto locked = metrics().start();
+					if (!make_room(shard, lock, fail_on_overflow ? overflow_policy::fail : overflow.load())) {
+						return false;
+					}
+					shard.resources.emplace(std::move(resource));
+					add_unpublished_resource(shard);
+					metrics().record_lock_hold(locked);
+				}
+				consumers_parker.notify_one();
+				return true;
+			}
+
+
+			bool has_available_resources(bool& swapped_queues) {
+				if (available_resources == 0 && unpublished_resources > 0 && (closed || flush_policy())) {
+					swapped_queues = swap_queues();
+				}
+				return available_resources > 0;
+			}
+
+			bool may_have_resources() const {
+				return available_resources > 0 || unpublished_resources > 0 || closed;
+			}
+
+			bool wait_for_resources(std::unique_lock<std::mutex>& lock, bool& swapped_queues) {
+				auto ready = [&] {
+					return has_available_resources(swapped_queues) || closed;
+				};
+				auto hint = [this] {
+					return may_have_resources();
+				};
+				while (!ready()) {
+					if (auto deadline = flush_deadline()) {
+						consumers_parker.wait_until(lock, *deadline, hint, ready);
+					} else {
+						consumers_parker.wait(lock, hint, [&] {
+							return ready() || flush_deadline();
+						});
+					}
+				}
+				return available_resources > 0;
+			}
+
+			template<typename clock_type, typename duration_type, typename stop_type>
+			bool wait_for_resources_until(std::unique_lock<std::mutex>& lock, bool& swapped_queues, const std::chrono::time_point<clock_type, duration_type>& deadline, const stop_type& stop) {
+				auto ready = [&] {
+					return has_available_resources(swapped_queues) || closed || stop();
+				};
+				auto hint = [this] {
+					return may_have_resources();
+				};
+				while (!ready() && clock_type::now() < deadline) {
+					auto flush_time = flush_deadline();
+					if (flush_time && clock_type::now() + (*flush_time - std::chrono::steady_clock::now()) < deadline) {
+						consumers_parker.wait_until(lock, *flush_time, hint, ready);
+					} else {
+						consumers_parker.wait_until(lock, deadline, hint, [&] {
+							return ready() || (!flush_time && flush_deadline());
+						});
+					}
+				}
+				return available_resources > 0;
+			}
+
+			resource_type pop_resource() {
+				resource_type resource(std::move(consumers_queue.front()));
+				consumers_queue.pop();
+				available_resources--;
+				return resource;
+			}
+
+			void finish_consumption(bool swapped_queues) {
+				if (swapped_queues) {
+					consumers_parker.notify_all();
+				}
+				producers_parker.notify_all();
+			}
+
 		public:
 			template<typename function_type>
 			typename std::enable_if<
@@ -55,104 +365,336 @@ namespace parallel_tools {
 			switch_policy(const function_type& custom_policy) {
 				{
 					std::lock_guard lock(consumers_mutex);
+					stop_tracking_unpublished_age();
 					flush_policy = custom_policy;
 				}
-				consumer_notifier.notify_one();
+				consumers_parker.notify_one();
 			}
 
 			void switch_policy(const flush_policy::batches_of& batches) {
 				{
 					std::lock_guard lock(consumers_mutex);
+					stop_tracking_unpublished_age();
 					flush_policy = [this, batches] {
 						return unpublished_resources >= batches.batch_size;
 					};
 				}
-				consumer_notifier.notify_one();
+				consumers_parker.notify_one();
 			}
 
 			void switch_policy(const flush_policy::maximum_waiting_consumers& maximum_consumers) {
 				{
 					std::lock_guard lock(consumers_mutex);
+					stop_tracking_unpublished_age();
 					flush_policy = [this, maximum_consumers] {
 						return waiting_consumers > maximum_consumers.number_of_consumers;
 					};
 				}
-				consumer_notifier.notify_one();
+				consumers_parker.notify_one();
+			}
+
+			void switch_policy(const flush_policy::max_latency& latency) {
+				{
+					std::lock_guard lock(consumers_mutex);
+					track_unpublished_age(latency.latency);
+					flush_policy = [this, latency] {
+						return unpublished_age() >= latency.latency;
+					};
+				}
+				consumers_parker.notify_all();
+			}
+
+			void switch_policy(const flush_policy::adaptive& adaptive) {
+				{
+					std::lock_guard lock(consumers_mutex);
+					track_unpublished_age(adaptive.latency);
+					flush_policy = [this, adaptive, batch_size = adaptive.minimum_batch_size]() mutable {
+						size_t pending_resources = unpublished_resources;
+						auto age = unpublished_age();
+						if (pending_resources >= batch_size) {
+							if (waiting_consumers <= 1 && age < adaptive.latency/2) {
+								batch_size = std::min(batch_size*2, adaptive.maximum_batch_size);
+							}
+							return true;
+						}
+						if (age >= adaptive.latency) {
+							batch_size = std::clamp(pending_resources, adaptive.minimum_batch_size, adaptive.maximum_batch_size);
+							return true;
+						}
+						if (waiting_consumers > 1) {
+							batch_size = std::max(batch_size/2, adaptive.minimum_batch_size);
+							return true;
+						}
+						return false;
+					};
+				}
+				consumers_parker.notify_all();
 			}
 
 			production_queue() :
+				producers_shards(1),
 				available_resources(0),
 				unpublished_resources(0),
 				waiting_consumers(0),
-				swap_in_progress(false)
+				swap_in_progress(false),
+				closed(false),
+				flush_latency(std::chrono::steady_clock::duration::max()),
+				tracks_unpublished_age(false),
+				oldest_unpublished_resource(0),
+				capacity(std::numeric_limits<size_t>::max()),
+				overflow(overflow_policy::block)
 			{
 				switch_policy(flush_policy::always);
 			}
 
 			template<typename function_type>
 			production_queue(const function_type& custom_policy) :
+				producers_shards(1),
 				available_resources(0),
 				unpublished_resources(0),
 				waiting_consumers(0),
-				swap_in_progress(false)
+				swap_in_progress(false),
+				closed(false),
+				flush_latency(std::chrono::steady_clock::duration::max()),
+				tracks_unpublished_age(false),
+				oldest_unpublished_resource(0),
+				capacity(std::numeric_limits<size_t>::max()),
+				overflow(overflow_policy::block)
 		   	{
 				switch_policy(custom_policy);
 			}
 
 			production_queue(const flush_policy::batches_of& batches) :
+				producers_shards(1),
 				available_resources(0),
 				unpublished_resources(0),
 				waiting_consumers(0),
-				swap_in_progress(false)
+				swap_in_progress(false),
+				closed(false),
+				flush_latency(std::chrono::steady_clock::duration::max()),
+				tracks_unpublished_age(false),
+				oldest_unpublished_resource(0),
+				capacity(std::numeric_limits<size_t>::max()),
+				overflow(overflow_policy::block)
 			{
 				switch_policy(batches);
 			}
 
 			production_queue(const flush_policy::maximum_waiting_consumers& maximum_consumers) :
+				producers_shards(1),
 				available_resources(0),
 				unpublished_resources(0),
 				waiting_consumers(0),
-				swap_in_progress(false)
+				swap_in_progress(false),
+				closed(false),
+				flush_latency(std::chrono::steady_clock::duration::max()),
+				tracks_unpublished_age(false),
+				oldest_unpublished_resource(0),
+				capacity(std::numeric_limits<size_t>::max()),
+				overflow(overflow_policy::block)
 			{
 				switch_policy(maximum_consumers);
 			}
 
+			production_queue(const queue_backend::double_buffer& buffer) :
+				production_queue(buffer, flush_policy::always)
+			{}
+
+			template<typename policy_type>
+			production_queue(const queue_backend::double_buffer& buffer, const policy_type& policy) :
+				producers_shards(std::max<size_t>(buffer.producer_shards, 1)),
+				available_resources(0),
+				unpublished_resources(0),
+				waiting_consumers(0),
+				swap_in_progress(false),
+				closed(false),
+				flush_latency(std::chrono::steady_clock::duration::max()),
+				tracks_unpublished_age(false),
+				oldest_unpublished_resource(0),
+				capacity(std::numeric_limits<size_t>::max()),
+				overflow(overflow_policy::block)
+			{
+				switch_policy(policy);
+			}
+
+
+			void limit_capacity(size_t maximum_resources, overflow_policy policy = overflow_policy::block) {
+				{
+					auto locks = lock_all_shards();
+					capacity = maximum_resources;
+					overflow = policy;
+				}
+				producers_parker.notify_all();
+			}
+
+			size_t get_capacity() {
+				return capacity;
+			}
+
+			template<typename... args_types>
+			bool produce(args_types... constructor_args) {
+				resource_type resource(std::forward<args_types...>(constructor_args...));
+				return publish(std::move(resource), false);
+			}
 
 			template<typename... args_types>
-			void produce(args_types... constructor_args) {
+			bool try_produce(args_types... constructor_args) {
 				resource_type resource(std::forward<args_types...>(constructor_args...));
+				return publish(std::move(resource), true);
+			}
+
+			template<typename iterator_type>
+			size_t produce_range(iterator_type first, iterator_type last) {
+				size_t produced_resources = 0;
 				{
-					std::lock_guard lock(producers_mutex);
-					producers_queue.emplace(std::move(resource));
-					unpublished_resources++;
+					auto& shard = current_shard();
+					std::unique_lock lock(shard.mutex);
+					auto locked = metrics().start();
+					for (; first != last; ++first) {
+						if (!make_room(shard, lock, overflow)) {
+							if (overflow == overflow_policy::drop_newest && !closed) {
+								continue;
+							}
+							break;
+						}
+						shard.resources.emplace(*first);
+						add_unpublished_resource(shard);
+						produced_resources++;
+					}
+					metrics().record_lock_hold(locked);
+				}
+				if (produced_resources > 0) {
+					consumers_parker.notify_one();
 				}
-				consumer_notifier.notify_one();
+				return produced_resources;
+			}
+
+			template<typename container_type>
+			size_t produce_bulk(container_type&& resources) {
+				static_assert(!std::is_lvalue_reference<container_type>::value, "produce_bulk requires an rvalue container, use produce_range for copying");
+				return produce_range(
+					std::make_move_iterator(std::begin(resources)),
+					std::make_move_iterator(std::end(resources))
+				);
 			}
 
 			resource_type consume () {
 				bool swapped_queues = false;
+				auto waiting = metrics().start();
 				waiting_consumers++;
 				resource_type resource;
 				{
 					std::unique_lock lock(consumers_mutex);
-					consumer_notifier.wait(lock, [&] {
-						if (available_resources == 0 && unpublished_resources > 0 && flush_policy()) {
-							swapped_queues = swap_queues();
-						}
-						return available_resources > 0;
-					});
+					auto resources_available = wait_for_resources(lock, swapped_queues);
 					waiting_consumers--;
+					auto locked = metrics().record_consumer_wait(waiting);
 
-					resource = std::move(consumers_queue.front());
-					consumers_queue.pop();
-					available_resources--;
+					if (!resources_available) {
+						throw queue_closed();
+					}
+					resource = pop_resource();
+					metrics().record_lock_hold(locked);
 				}
-				if (swapped_queues) {
-					consumer_notifier.notify_all();
+				finish_consumption(swapped_queues);
+				return resource;
+			}
+
+			std::optional<resource_type> try_consume() {
+				bool swapped_queues = false;
+				std::optional<resource_type> resource;
+				{
+					std::lock_guard lock(consumers_mutex);
+					auto locked = metrics().start();
+					if (has_available_resources(swapped_queues)) {
+						resource.emplace(pop_resource());
+					}
+					metrics().record_lock_hold(locked);
 				}
+				finish_consumption(swapped_queues);
 				return resource;
 			}
 
+			template<typename clock_type, typename duration_type, typename stop_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline, const stop_type& stop) {
+				bool swapped_queues = false;
+				std::optional<resource_type> resource;
+				auto waiting = metrics().start();
+				waiting_consumers++;
+				{
+					std::unique_lock lock(consumers_mutex);
+					wait_for_resources_until(lock, swapped_queues, deadline, stop);
+					waiting_consumers--;
+					auto locked = metrics().record_consumer_wait(waiting);
+
+					if (available_resources > 0) {
+						resource.emplace(pop_resource());
+					}
+					metrics().record_lock_hold(locked);
+				}
+				finish_consumption(swapped_queues);
+				return resource;
+			}
+
+			template<typename clock_type, typename duration_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline) {
+				return consume_until(deadline, [] { return false; });
+			}
+
+			template<typename rep_type, typename period_type>
+			std::optional<resource_type> consume_for(const std::chrono::duration<rep_type, period_type>& timeout) {
+				return consume_until(std::chrono::steady_clock::now() + timeout);
+			}
+
+			template<typename output_iterator_type>
+			size_t consume_batch(output_iterator_type output, size_t maximum_resources) {
+				if (maximum_resources == 0) {
+					return 0;
+				}
+
+				bool swapped_queues = false;
+				size_t consumed_resources = 0;
+				auto waiting = metrics().start();
+				waiting_consumers++;
+				{
+					std::unique_lock lock(consumers_mutex);
+					auto resources_available = wait_for_resources(lock, swapped_queues);
+					waiting_consumers--;
+					auto locked = metrics().record_consumer_wait(waiting);
+
+					if (!resources_available) {
+						throw queue_closed();
+					}
+					while (consumed_resources < maximum_resources && !consumers_queue.empty()) {
+						*output = std::move(consumers_queue.front());
+						++output;
+						consumers_queue.pop();
+						consumed_resources++;
+					}
+					available_resources -= consumed_resources;
+					metrics().record_lock_hold(locked);
+				}
+				finish_consumption(swapped_queues);
+				return consumed_resources;
+			}
+
+			void wake_consumers() {
+				consumers_parker.notify_all();
+			}
+
+			void close() {
+				{
+					std::lock_guard consumers_lock(consumers_mutex);
+					auto producers_locks = lock_all_shards();
+					closed = true;
+				}
+				consumers_parker.notify_all();
+				producers_parker.notify_all();
+			}
+
+			bool is_closed() const {
+				return closed;
+			}
+
 			size_t get_available_resources() {
 				return available_resources;
 			}
@@ -160,6 +702,558 @@ namespace parallel_tools {
 			size_t get_unpublished_resources() {
 				return unpublished_resources;
 			}
+
+			queue_metrics_snapshot get_metrics() const {
+				return metrics().snapshot();
+			}
 	};
-}
 
+	template<typename resource_type, typename wait_strategy_type>
+	class production_queue<resource_type, queue_backend::ring_buffer, wait_strategy_type> {
+		static_assert(is_wait_strategy<wait_strategy_type>::value, "unknown production_queue wait strategy");
+
+		private:
+			struct alignas(cache_line_size) slot {
+				std::atomic<size_t> sequence;
+				typename std::aligned_storage<sizeof(resource_type), alignof(resource_type)>::type storage;
+
+				resource_type* resource() {
+					return reinterpret_cast<resource_type*>(&storage);
+				}
+			};
+
+			static constexpr size_t closed_bit = size_t(1) << (std::numeric_limits<size_t>::digits - 1);
+
+			const size_t mask;
+			std::unique_ptr<slot[]> slots;
+			alignas(cache_line_size) std::atomic<size_t> enqueue_position;
+			alignas(cache_line_size) std::atomic<size_t> dequeue_position;
+			alignas(cache_line_size) thread_parker<wait_strategy_type> producers_parker;
+			alignas(cache_line_size) thread_parker<wait_strategy_type> consumers_parker;
+
+			bool can_push() const {
+				auto position = enqueue_position.load(std::memory_order_relaxed) & ~closed_bit;
+				auto sequence = slots[position & mask].sequence.load(std::memory_order_acquire);
+				return static_cast<std::intptr_t>(sequence - position) >= 0;
+			}
+
+			bool can_pop() const {
+				auto position = dequeue_position.load(std::memory_order_relaxed);
+				auto sequence = slots[position & mask].sequence.load(std::memory_order_acquire);
+				return static_cast<std::intptr_t>(sequence - (position + 1)) >= 0;
+			}
+
+			bool drained() const {
+				auto position = enqueue_position.load(std::memory_order_acquire);
+				return (position & closed_bit) && (position & ~closed_bit) == dequeue_position.load(std::memory_order_acquire);
+			}
+
+			bool try_push(resource_type& resource) {
+				auto position = enqueue_position.load(std::memory_order_relaxed);
+				slot* target;
+				while (true) {
+					if (position & closed_bit) {
+						return false;
+					}
+					target = &slots[position & mask];
+					auto sequence = target->sequence.load(std::memory_order_acquire);
+					auto difference = static_cast<std::intptr_t>(sequence - position);
+					if (difference == 0) {
+						if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							break;
+						}
+					} else if (difference < 0) {
+						return false;
+					} else {
+						position = enqueue_position.load(std::memory_order_relaxed);
+					}
+				}
+				new (target->resource()) resource_type(std::move(resource));
+				target->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+
+			bool try_pop(resource_type& resource) {
+				auto position = dequeue_position.load(std::memory_order_relaxed);
+				slot* source;
+				while (true) {
+					source = &slots[position & mask];
+					auto sequence = source->sequence.load(std::memory_order_acquire);
+					auto difference = static_cast<std::intptr_t>(sequence - (position + 1));
+					if (difference == 0) {
+						if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							break;
+						}
+					} else if (difference < 0) {
+						return false;
+					} else {
+						position = dequeue_position.load(std::memory_order_relaxed);
+					}
+				}
+				resource = std::move(*source->resource());
+				source->resource()->~resource_type();
+				source->sequence.store(position + mask + 1, std::memory_order_release);
+				return true;
+			}
+
+		public:
+			explicit production_queue(size_t capacity) :
+				mask(round_to_power_of_two(capacity) - 1),
+				slots(new slot[mask + 1]),
+				enqueue_position(0),
+				dequeue_position(0)
+			{
+				for (size_t i = 0; i <= mask; i++) {
+					slots[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			production_queue(const queue_backend::ring_buffer& ring) :
+				production_queue(ring.capacity)
+			{}
+
+			~production_queue() {
+				resource_type resource;
+				while (try_pop(resource));
+			}
+
+			template<typename... args_types>
+			bool produce(args_types&&... constructor_args) {
+				if (is_closed()) {
+					return false;
+				}
+				resource_type resource(std::forward<args_types>(constructor_args)...);
+				while (!try_push(resource)) {
+					producers_parker.wait([this] { return is_closed() || can_push(); });
+					if (is_closed()) {
+						return false;
+					}
+				}
+				consumers_parker.notify_one();
+				return true;
+			}
+
+			void finish_pop() {
+				producers_parker.notify_one();
+				if (drained()) {
+					consumers_parker.notify_all();
+				}
+			}
+
+			resource_type consume() {
+				resource_type resource;
+				while (!try_pop(resource)) {
+					if (drained()) {
+						throw queue_closed();
+					}
+					consumers_parker.wait([this] { return can_pop() || drained(); });
+				}
+				finish_pop();
+				return resource;
+			}
+
+			std::optional<resource_type> try_consume() {
+				resource_type resource;
+				if (!try_pop(resource)) {
+					return std::nullopt;
+				}
+				finish_pop();
+				return resource;
+			}
+
+			template<typename clock_type, typename duration_type, typename stop_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline, const stop_type& stop) {
+				resource_type resource;
+				while (!try_pop(resource)) {
+					if (drained() || stop()) {
+						return std::nullopt;
+					}
+					if (!consumers_parker.wait_until(deadline, [&] { return can_pop() || drained() || stop(); })) {
+						return std::nullopt;
+					}
+				}
+				finish_pop();
+				return resource;
+			}
+
+			template<typename clock_type, typename duration_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline) {
+				return consume_until(deadline, [] { return false; });
+			}
+
+			template<typename rep_type, typename period_type>
+			std::optional<resource_type> consume_for(const std::chrono::duration<rep_type, period_type>& timeout) {
+				return consume_until(std::chrono::steady_clock::now() + timeout);
+			}
+
+			void wake_consumers() {
+				consumers_parker.notify_all();
+			}
+
+			void close() {
+				enqueue_position.fetch_or(closed_bit, std::memory_order_acq_rel);
+				consumers_parker.notify_all();
+				producers_parker.notify_all();
+			}
+
+			bool is_closed() const {
+				return enqueue_position.load(std::memory_order_acquire) & closed_bit;
+			}
+
+			size_t get_capacity() const {
+				return mask + 1;
+			}
+
+			size_t get_available_resources() {
+				auto produced = enqueue_position.load(std::memory_order_relaxed) & ~closed_bit;
+				auto consumed = dequeue_position.load(std::memory_order_relaxed);
+				return produced > consumed ? produced - consumed : 0;
+			}
+
+			size_t get_unpublished_resources() {
+				return 0;
+			}
+	};
+
+	template<typename resource_type, typename wait_strategy_type>
+	class production_queue<resource_type, queue_backend::spsc, wait_strategy_type> {
+		static_assert(is_wait_strategy<wait_strategy_type>::value, "unknown production_queue wait strategy");
+
+		private:
+			using storage_type = typename std::aligned_storage<sizeof(resource_type), alignof(resource_type)>::type;
+
+			const size_t mask;
+			std::unique_ptr<storage_type[]> buffer;
+			std::atomic<bool> closed;
+			alignas(cache_line_size) std::atomic<size_t> head;
+			size_t cached_tail;
+			alignas(cache_line_size) std::atomic<size_t> tail;
+			size_t cached_head;
+			alignas(cache_line_size) thread_parker<wait_strategy_type> producer_parker;
+			alignas(cache_line_size) thread_parker<wait_strategy_type> consumer_parker;
+
+			resource_type* slot(size_t position) {
+				return reinterpret_cast<resource_type*>(&buffer[position & mask]);
+			}
+
+			resource_type pop(size_t position) {
+				resource_type resource(std::move(*slot(position)));
+				slot(position)->~resource_type();
+				head.store(position + 1, std::memory_order_release);
+				producer_parker.notify_one();
+				return resource;
+			}
+
+		public:
+			explicit production_queue(size_t capacity) :
+				mask(round_to_power_of_two(capacity) - 1),
+				buffer(new storage_type[mask + 1]),
+				closed(false),
+				head(0),
+				cached_tail(0),
+				tail(0),
+				cached_head(0)
+			{}
+
+			production_queue(const queue_backend::spsc& spsc) :
+				production_queue(spsc.capacity)
+			{}
+
+			~production_queue() {
+				auto end = tail.load(std::memory_order_acquire);
+				for (auto position = head.load(std::memory_order_relaxed); position != end; position++) {
+					slot(position)->~resource_type();
+				}
+			}
+
+			template<typename... args_types>
+			bool produce(args_types&&... constructor_args) {
+				if (closed) {
+					return false;
+				}
+				auto position = tail.load(std::memory_order_relaxed);
+				if (position - cached_head > mask) {
+					cached_head = head.load(std::memory_order_acquire);
+					if (position - cached_head > mask) {
+						producer_parker.wait([&] {
+							return closed || position - head.load(std::memory_order_acquire) <= mask;
+						});
+						if (closed) {
+							return false;
+						}
+						cached_head = head.load(std::memory_order_acquire);
+					}
+				}
+				new (slot(position)) resource_type(std::forward<args_types>(constructor_args)...);
+				tail.store(position + 1, std::memory_order_release);
+				consumer_parker.notify_one();
+				return true;
+			}
+
+			resource_type consume() {
+				auto position = head.load(std::memory_order_relaxed);
+				if (position == cached_tail) {
+					cached_tail = tail.load(std::memory_order_acquire);
+					if (position == cached_tail) {
+						consumer_parker.wait([&] {
+							return closed || position != tail.load(std::memory_order_acquire);
+						});
+						cached_tail = tail.load(std::memory_order_acquire);
+						if (position == cached_tail) {
+							throw queue_closed();
+						}
+					}
+				}
+				return pop(position);
+			}
+
+			std::optional<resource_type> try_consume() {
+				auto position = head.load(std::memory_order_relaxed);
+				if (position == cached_tail) {
+					cached_tail = tail.load(std::memory_order_acquire);
+					if (position == cached_tail) {
+						return std::nullopt;
+					}
+				}
+				return pop(position);
+			}
+
+			template<typename clock_type, typename duration_type, typename stop_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline, const stop_type& stop) {
+				auto position = head.load(std::memory_order_relaxed);
+				if (position == cached_tail) {
+					cached_tail = tail.load(std::memory_order_acquire);
+					if (position == cached_tail) {
+						consumer_parker.wait_until(deadline, [&] {
+							return closed || position != tail.load(std::memory_order_acquire) || stop();
+						});
+						cached_tail = tail.load(std::memory_order_acquire);
+						if (position == cached_tail) {
+							return std::nullopt;
+						}
+					}
+				}
+				return pop(position);
+			}
+
+			template<typename clock_type, typename duration_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline) {
+				return consume_until(deadline, [] { return false; });
+			}
+
+			template<typename rep_type, typename period_type>
+			std::optional<resource_type> consume_for(const std::chrono::duration<rep_type, period_type>& timeout) {
+				return consume_until(std::chrono::steady_clock::now() + timeout);
+			}
+
+			void wake_consumers() {
+				consumer_parker.notify_all();
+			}
+
+			void close() {
+				closed = true;
+				consumer_parker.notify_all();
+				producer_parker.notify_all();
+			}
+
+			bool is_closed() const {
+				return closed;
+			}
+
+			size_t get_capacity() const {
+				return mask + 1;
+			}
+
+			size_t get_available_resources() {
+				return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+			}
+
+			size_t get_unpublished_resources() {
+				return 0;
+			}
+	};
+
+	template<typename resource_type, typename wait_strategy_type>
+	class production_queue<resource_type, queue_backend::priority_levels, wait_strategy_type> {
+		static_assert(is_wait_strategy<wait_strategy_type>::value, "unknown production_queue wait strategy");
+
+		private:
+			struct alignas(cache_line_size) lane {
+				production_queue<resource_type, queue_backend::double_buffer, wait_strategy_type> resources;
+				std::atomic<size_t> pending_resources{0};
+				std::atomic<std::chrono::steady_clock::rep> waiting_since{0};
+			};
+
+			std::vector<lane> lanes;
+			const std::chrono::steady_clock::duration aging;
+			std::atomic<size_t> pending_resources;
+			std::atomic<bool> closed;
+			thread_parker<wait_strategy_type> consumers_parker;
+
+			static std::chrono::steady_clock::rep now() {
+				return std::chrono::steady_clock::now().time_since_epoch().count();
+			}
+
+			bool ages() const {
+				return aging != std::chrono::steady_clock::duration::max();
+			}
+
+			lane& lane_of(priority level) {
+				return lanes[std::min(level.level, lanes.size() - 1)];
+			}
+
+			std::optional<resource_type> consume_from(lane& source) {
+				auto resource = source.resources.try_consume();
+				if (resource) {
+					if (source.pending_resources-- > 1 && ages()) {
+						source.waiting_since = now();
+					}
+					pending_resources--;
+				}
+				return resource;
+			}
+
+			lane* starving_lane() {
+				if (!ages()) {
+					return nullptr;
+				}
+				auto starvation_limit = now() - aging.count();
+				lane* starving = nullptr;
+				for (auto& candidate : lanes) {
+					if (candidate.pending_resources > 0 && candidate.waiting_since <= starvation_limit) {
+						if (!starving || candidate.waiting_since < starving->waiting_since) {
+							starving = &candidate;
+						}
+					}
+				}
+				return starving;
+			}
+
+			std::optional<resource_type> pop_resource() {
+				if (auto starving = starving_lane()) {
+					if (auto resource = consume_from(*starving)) {
+						return resource;
+					}
+				}
+				for (auto source = lanes.rbegin(); source != lanes.rend(); ++source) {
+					if (source->pending_resources > 0) {
+						if (auto resource = consume_from(*source)) {
+							return resource;
+						}
+					}
+				}
+				return std::nullopt;
+			}
+
+		public:
+			explicit production_queue(size_t levels, std::chrono::steady_clock::duration aging = std::chrono::steady_clock::duration::max()) :
+				lanes(std::max<size_t>(levels, 1)),
+				aging(aging),
+				pending_resources(0),
+				closed(false)
+			{}
+
+			production_queue(const queue_backend::priority_levels& priority_levels) :
+				production_queue(priority_levels.levels, priority_levels.aging)
+			{}
+
+			template<typename... args_types>
+			bool produce(priority level, args_types&&... constructor_args) {
+				if (closed) {
+					return false;
+				}
+				auto& target = lane_of(level);
+				if (target.pending_resources++ == 0 && ages()) {
+					target.waiting_since = now();
+				}
+				pending_resources++;
+				if (!target.resources.produce(resource_type(std::forward<args_types>(constructor_args)...))) {
+					target.pending_resources--;
+					pending_resources--;
+					return false;
+				}
+				consumers_parker.notify_one();
+				return true;
+			}
+
+			bool produce(resource_type resource) {
+				return produce(priority{0}, std::move(resource));
+			}
+
+			resource_type consume() {
+				while (true) {
+					consumers_parker.wait([this] {
+						return pending_resources > 0 || closed;
+					});
+					if (auto resource = pop_resource()) {
+						return std::move(*resource);
+					}
+					if (closed && pending_resources == 0) {
+						throw queue_closed();
+					}
+					std::this_thread::yield();
+				}
+			}
+
+			std::optional<resource_type> try_consume() {
+				return pop_resource();
+			}
+
+			template<typename clock_type, typename duration_type, typename stop_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline, const stop_type& stop) {
+				while (true) {
+					auto resources_available = consumers_parker.wait_until(deadline, [&] {
+						return pending_resources > 0 || closed || stop();
+					});
+					if (!resources_available) {
+						return std::nullopt;
+					}
+					if (auto resource = pop_resource()) {
+						return resource;
+					}
+					if ((closed && pending_resources == 0) || stop()) {
+						return std::nullopt;
+					}
+					std::this_thread::yield();
+				}
+			}
+
+			template<typename clock_type, typename duration_type>
+			std::optional<resource_type> consume_until(const std::chrono::time_point<clock_type, duration_type>& deadline) {
+				return consume_until(deadline, [] { return false; });
+			}
+
+			template<typename rep_type, typename period_type>
+			std::optional<resource_type> consume_for(const std::chrono::duration<rep_type, period_type>& timeout) {
+				return consume_until(std::chrono::steady_clock::now() + timeout);
+			}
+
+			void wake_consumers() {
+				consumers_parker.notify_all();
+			}
+
+			void close() {
+				closed = true;
+				for (auto& source : lanes) {
+					source.resources.close();
+				}
+				consumers_parker.notify_all();
+			}
+
+			bool is_closed() const {
+				return closed;
+			}
+
+			size_t get_levels() const {
+				return lanes.size();
+			}
+
+			size_t get_available_resources() {
+				return pending_resources;
+			}
+
+			size_t get_unpublished_resources() {
+				return 0;
+			}
+	};
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "hardware.h"
+
+namespace parallel_tools {
+	template<typename resource_type>
+	class segmented_queue {
+		private:
+			static constexpr size_t block_capacity = std::max<size_t>(1, 16*cache_line_size/sizeof(resource_type));
+
+			struct alignas(cache_line_size) block {
+				block* next;
+				size_t begin;
+				size_t end;
+				alignas(resource_type) unsigned char storage[block_capacity*sizeof(resource_type)];
+
+				resource_type* at(size_t index) {
+					return std::launder(reinterpret_cast<resource_type*>(storage) + index);
+				}
+			};
+
+			block* head;
+			block* tail;
+			block* free_blocks;
+			size_t number_of_resources;
+			size_t number_of_blocks;
+			size_t number_of_free_blocks;
+
+			block* acquire_block() {
+				block* acquired_block;
+				if (free_blocks) {
+					acquired_block = free_blocks;
+					free_blocks = free_blocks->next;
+					number_of_free_blocks--;
+				} else {
+					acquired_block = new block;
+				}
+				acquired_block->next = nullptr;
+				acquired_block->begin = 0;
+				acquired_block->end = 0;
+				return acquired_block;
+			}
+
+			void release_block(block* released_block) {
+				released_block->next = free_blocks;
+				free_blocks = released_block;
+				number_of_free_blocks++;
+			}
+
+			void release_head() {
+				auto released_block = head;
+				head = head->next;
+				if (!head) {
+					tail = nullptr;
+				}
+				number_of_blocks--;
+				release_block(released_block);
+			}
+
+		public:
+			segmented_queue() :
+				head(nullptr),
+				tail(nullptr),
+				free_blocks(nullptr),
+				number_of_resources(0),
+				number_of_blocks(0),
+				number_of_free_blocks(0)
+			{}
+
+			segmented_queue(const segmented_queue&) = delete;
+			segmented_queue& operator=(const segmented_queue&) = delete;
+
+			~segmented_queue() {
+				while (!empty()) {
+					pop();
+				}
+				while (head) {
+					release_head();
+				}
+				while (free_blocks) {
+					auto next = free_blocks->next;
+					delete free_blocks;
+					free_blocks = next;
+				}
+			}
+
+			template<typename... args_types>
+			void emplace(args_types&&... args) {
+				if (!tail || tail->end == block_capacity) {
+					auto new_block = acquire_block();
+					if (tail) {
+						tail->next = new_block;
+					} else {
+						head = new_block;
+					}
+					tail = new_block;
+					number_of_blocks++;
+				}
+				new (tail->at(tail->end)) resource_type(std::forward<args_types>(args)...);
+				tail->end++;
+				number_of_resources++;
+			}
+
+			void push(resource_type&& resource) {
+				emplace(std::move(resource));
+			}
+
+			void push(const resource_type& resource) {
+				emplace(resource);
+			}
+
+			resource_type& front() {
+				return *head->at(head->begin);
+			}
+
+			void pop() {
+				head->at(head->begin)->~resource_type();
+				head->begin++;
+				number_of_resources--;
+				if (head->begin == head->end) {
+					if (head == tail) {
+						head->begin = 0;
+						head->end = 0;
+					} else {
+						release_head();
+					}
+				}
+			}
+
+			void splice(segmented_queue& other) {
+				if (other.empty()) {
+					return;
+				}
+				if (empty()) {
+					while (head) {
+						release_head();
+					}
+				}
+
+				if (tail) {
+					tail->next = other.head;
+				} else {
+					head = other.head;
+				}
+				tail = other.tail;
+				number_of_resources += other.number_of_resources;
+				number_of_blocks += other.number_of_blocks;
+
+				auto recycled_blocks = std::min(number_of_free_blocks, other.number_of_blocks);
+				other.head = nullptr;
+				other.tail = nullptr;
+				other.number_of_resources = 0;
+				other.number_of_blocks = 0;
+				for (size_t i = 0; i < recycled_blocks; i++) {
+					auto recycled_block = free_blocks;
+					free_blocks = free_blocks->next;
+					number_of_free_blocks--;
+					other.release_block(recycled_block);
+				}
+			}
+
+			bool empty() const {
+				return number_of_resources == 0;
+			}
+
+			size_t size() const {
+				return number_of_resources;
+			}
+
+			size_t get_free_blocks() const {
+				return number_of_free_blocks;
+			}
+	};
+}
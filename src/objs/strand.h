@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hardware.h"
+#include "pooled_allocator.h"
+#include "segmented_queue.h"
+#include "task.h"
+#include "thread_pool.h"
+
+namespace parallel_tools {
+	class serial_queue {
+		private:
+			std::mutex mutex;
+			segmented_queue<task> tasks;
+			bool scheduled;
+
+		public:
+			static constexpr size_t tasks_per_turn = 64;
+
+			serial_queue() :
+				scheduled(false)
+			{}
+
+			bool push(task&& pushed_task) {
+				std::lock_guard lock(mutex);
+				tasks.push(std::move(pushed_task));
+				if (scheduled) {
+					return false;
+				}
+				scheduled = true;
+				return true;
+			}
+
+			std::optional<task> try_pop() {
+				std::lock_guard lock(mutex);
+				if (tasks.empty()) {
+					return std::nullopt;
+				}
+				std::optional<task> popped_task(std::move(tasks.front()));
+				tasks.pop();
+				return popped_task;
+			}
+
+			bool finish_if_empty() {
+				std::lock_guard lock(mutex);
+				if (!tasks.empty()) {
+					return false;
+				}
+				scheduled = false;
+				return true;
+			}
+
+			size_t size() {
+				std::lock_guard lock(mutex);
+				return tasks.size();
+			}
+
+			template<typename finish_type>
+			static void drain(const std::shared_ptr<serial_queue>& queue, thread_pool& pool, const finish_type& finish) {
+				for (size_t executed_tasks = 0; executed_tasks < tasks_per_turn;) {
+					if (auto next_task = queue->try_pop()) {
+						pool.run_task(*next_task);
+						executed_tasks++;
+					} else if (finish()) {
+						return;
+					}
+				}
+				pool.post([queue, &pool, finish] {
+					drain(queue, pool, finish);
+				});
+			}
+	};
+
+	class strand {
+		private:
+			thread_pool& pool;
+			std::shared_ptr<serial_queue> queue;
+
+			void enqueue(task&& enqueued_task) {
+				if (queue->push(std::move(enqueued_task))) {
+					pool.post([queue = queue, &pool = pool] {
+						serial_queue::drain(queue, pool, [queue] {
+							return queue->finish_if_empty();
+						});
+					});
+				}
+			}
+
+		public:
+			explicit strand(thread_pool& pool) :
+				pool(pool),
+				queue(std::make_shared<serial_queue>())
+			{}
+
+			template<typename function_type, typename... args_types>
+			void post(function_type&& function, args_types&&... args) {
+				enqueue(make_posted_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename return_type = typename std::invoke_result<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::type
+			>
+			std::future<return_type> exec(function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
+				enqueue(make_task(std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...));
+				return future;
+			}
+
+			size_t get_pending_tasks() {
+				return queue->size();
+			}
+	};
+
+	template<typename key_type, typename hash_type = std::hash<key_type>>
+	class keyed_executor {
+		private:
+			static constexpr size_t number_of_shards = 64;
+
+			struct alignas(cache_line_size) shard {
+				std::mutex mutex;
+				std::unordered_map<key_type, std::shared_ptr<serial_queue>, hash_type> queues;
+			};
+
+			class active_key {
+				private:
+					keyed_executor* executor;
+
+				public:
+					explicit active_key(keyed_executor* executor) noexcept :
+						executor(executor)
+					{
+						executor->active_keys.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					active_key(const active_key& other) noexcept :
+						active_key(other.executor)
+					{}
+
+					active_key& operator=(const active_key&) = delete;
+
+					~active_key() {
+						auto keys = executor->active_keys.load(std::memory_order_relaxed);
+						while (keys > 1) {
+							if (executor->active_keys.compare_exchange_weak(keys, keys - 1, std::memory_order_release, std::memory_order_relaxed)) {
+								return;
+							}
+						}
+						std::lock_guard lock(executor->active_keys_mutex);
+						if (executor->active_keys.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+							executor->keys_finished.notify_all();
+						}
+					}
+			};
+
+			thread_pool& pool;
+			hash_type hash;
+			std::unique_ptr<shard[]> shards;
+			std::mutex active_keys_mutex;
+			std::condition_variable keys_finished;
+			std::atomic<size_t> active_keys;
+
+			shard& shard_of(const key_type& key) {
+				return shards[hash(key) % number_of_shards];
+			}
+
+			void enqueue(const key_type& key, task&& enqueued_task) {
+				auto& key_shard = shard_of(key);
+				std::shared_ptr<serial_queue> queue;
+				{
+					std::lock_guard lock(key_shard.mutex);
+					auto& key_queue = key_shard.queues[key];
+					if (!key_queue) {
+						key_queue = std::make_shared<serial_queue>();
+					}
+					if (!key_queue->push(std::move(enqueued_task))) {
+						return;
+					}
+					queue = key_queue;
+				}
+				pool.post([this, key, queue = std::move(queue), active = active_key(this)] {
+					serial_queue::drain(queue, pool, [this, key, queue, active] {
+						auto& key_shard = shard_of(key);
+						std::lock_guard lock(key_shard.mutex);
+						if (!queue->finish_if_empty()) {
+							return false;
+						}
+						key_shard.queues.erase(key);
+						return true;
+					});
+				});
+			}
+
+		public:
+			explicit keyed_executor(thread_pool& pool, const hash_type& hash = hash_type()) :
+				pool(pool),
+				hash(hash),
+				shards(new shard[number_of_shards]),
+				active_keys(0)
+			{}
+
+			keyed_executor(const keyed_executor&) = delete;
+			keyed_executor& operator=(const keyed_executor&) = delete;
+
+			~keyed_executor() {
+				std::unique_lock lock(active_keys_mutex);
+				keys_finished.wait(lock, [this] {
+					return active_keys.load(std::memory_order_acquire) == 0;
+				});
+			}
+
+			template<typename function_type, typename... args_types>
+			void post(const key_type& key, function_type&& function, args_types&&... args) {
+				enqueue(key, make_posted_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename return_type = typename std::invoke_result<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::type
+			>
+			std::future<return_type> exec(const key_type& key, function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
+				enqueue(key, make_task(std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...));
+				return future;
+			}
+
+			size_t get_active_keys() {
+				size_t active_keys = 0;
+				for (size_t i = 0; i < number_of_shards; i++) {
+					std::lock_guard lock(shards[i].mutex);
+					active_keys += shards[i].queues.size();
+				}
+				return active_keys;
+			}
+	};
+}
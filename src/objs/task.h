@@ -0,0 +1,253 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "cancellation.h"
+#include "metrics.h"
+#include "pooled_allocator.h"
+#include "tracing.h"
+
+namespace parallel_tools {
+	struct enqueue_stamp {
+		std::chrono::steady_clock::time_point time;
+		int64_t tick = 0;
+	};
+
+	template<bool enabled = metrics_enabled || tracing_enabled>
+	class task_stamp;
+
+	template<>
+	class task_stamp<true> {
+		private:
+			enqueue_stamp stamp;
+
+		public:
+			const enqueue_stamp& get_enqueue_stamp() const {
+				return stamp;
+			}
+
+			void set_enqueue_stamp(const enqueue_stamp& new_stamp) {
+				stamp = new_stamp;
+			}
+	};
+
+	template<>
+	class task_stamp<false> {
+		public:
+			enqueue_stamp get_enqueue_stamp() const {
+				return {};
+			}
+
+			void set_enqueue_stamp(const enqueue_stamp&) {}
+	};
+
+	class task : public task_stamp<> {
+		private:
+			static constexpr size_t inline_capacity = 64 - sizeof(void*);
+
+			struct operations {
+				void (*invoke)(void* storage);
+				void (*relocate)(void* from, void* to);
+				void (*destroy)(void* storage);
+			};
+
+			template<typename function_type>
+			static constexpr bool stored_inline =
+				sizeof(function_type) <= inline_capacity &&
+				alignof(function_type) <= alignof(std::max_align_t) &&
+				std::is_nothrow_move_constructible<function_type>::value;
+
+			template<typename function_type>
+			struct inline_operations {
+				static function_type& function(void* storage) {
+					return *std::launder(reinterpret_cast<function_type*>(storage));
+				}
+
+				static void invoke(void* storage) {
+					function(storage)();
+				}
+
+				static void relocate(void* from, void* to) {
+					new (to) function_type(std::move(function(from)));
+					function(from).~function_type();
+				}
+
+				static void destroy(void* storage) {
+					function(storage).~function_type();
+				}
+
+				static constexpr operations table = {invoke, relocate, destroy};
+			};
+
+			template<typename function_type>
+			struct pooled_operations {
+				static function_type*& function(void* storage) {
+					return *std::launder(reinterpret_cast<function_type**>(storage));
+				}
+
+				static void invoke(void* storage) {
+					(*function(storage))();
+				}
+
+				static void relocate(void* from, void* to) {
+					new (to) function_type*(function(from));
+				}
+
+				static void destroy(void* storage) {
+					function(storage)->~function_type();
+					pooled_allocator<function_type>().deallocate(function(storage), 1);
+				}
+
+				static constexpr operations table = {invoke, relocate, destroy};
+			};
+
+			alignas(std::max_align_t) unsigned char storage[inline_capacity];
+			const operations* callable_operations;
+
+			void reset() {
+				if (callable_operations) {
+					callable_operations->destroy(storage);
+					callable_operations = nullptr;
+				}
+			}
+
+		public:
+			task() noexcept :
+				callable_operations(nullptr)
+			{}
+
+			template<
+				typename function_type,
+				typename stored_type = typename std::decay<function_type>::type,
+				typename = typename std::enable_if<!std::is_same<stored_type, task>::value>::type
+			>
+			task(function_type&& function) {
+				if constexpr (stored_inline<stored_type>) {
+					new (storage) stored_type(std::forward<function_type>(function));
+					callable_operations = &inline_operations<stored_type>::table;
+				} else {
+					pooled_allocator<stored_type> allocator;
+					auto pooled_function = allocator.allocate(1);
+					try {
+						new (pooled_function) stored_type(std::forward<function_type>(function));
+					} catch (...) {
+						allocator.deallocate(pooled_function, 1);
+						throw;
+					}
+					new (storage) stored_type*(pooled_function);
+					callable_operations = &pooled_operations<stored_type>::table;
+				}
+			}
+
+			task(task&& other) noexcept :
+				task_stamp(other),
+				callable_operations(other.callable_operations)
+			{
+				if (callable_operations) {
+					callable_operations->relocate(other.storage, storage);
+					other.callable_operations = nullptr;
+				}
+			}
+
+			task& operator=(task&& other) noexcept {
+				if (this != &other) {
+					reset();
+					task_stamp::operator=(other);
+					callable_operations = other.callable_operations;
+					if (callable_operations) {
+						callable_operations->relocate(other.storage, storage);
+						other.callable_operations = nullptr;
+					}
+				}
+				return *this;
+			}
+
+			task(const task&) = delete;
+			task& operator=(const task&) = delete;
+
+			~task() {
+				reset();
+			}
+
+			void operator()() {
+				callable_operations->invoke(storage);
+			}
+
+			explicit operator bool() const {
+				return callable_operations != nullptr;
+			}
+	};
+
+	inline task make_posted_task(task&& posted_task) {
+		return std::move(posted_task);
+	}
+
+	template<typename token_type, typename function_type, typename... args_types>
+	task make_guarded_posted_task(token_type token, function_type&& function, args_types&&... args) {
+		return task([
+			function = std::forward<function_type>(function),
+			arguments = std::make_tuple(std::move(token), std::forward<args_types>(args)...)
+		] () mutable {
+			std::apply([&function](auto&& token, auto&&... arguments) {
+				if (!token.stop_requested()) {
+					std::invoke(function, std::forward<decltype(arguments)>(arguments)...);
+				}
+			}, std::move(arguments));
+		});
+	}
+
+	template<
+		typename function_type,
+		typename... args_types,
+		typename = typename std::enable_if<std::is_invocable<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::value>::type
+	>
+	task make_posted_task(function_type&& function, args_types&&... args) {
+		return make_guarded_posted_task(no_cancellation(), std::forward<function_type>(function), std::forward<args_types>(args)...);
+	}
+
+	template<typename function_type, typename... args_types>
+	task make_posted_task(const cancellation_token& token, function_type&& function, args_types&&... args) {
+		return make_guarded_posted_task(token, std::forward<function_type>(function), std::forward<args_types>(args)...);
+	}
+
+	template<typename token_type, typename return_type, typename function_type, typename... args_types>
+	task make_guarded_task(token_type token, std::promise<return_type>&& promise, function_type&& function, args_types&&... args) {
+		return task([
+			promise = std::move(promise),
+			function = std::forward<function_type>(function),
+			arguments = std::make_tuple(std::move(token), std::forward<args_types>(args)...)
+		] () mutable {
+			try {
+				std::apply([&promise, &function](auto&& token, auto&&... arguments) {
+					token.throw_if_stop_requested();
+					if constexpr (std::is_void<return_type>::value) {
+						std::invoke(function, std::forward<decltype(arguments)>(arguments)...);
+						promise.set_value();
+					} else {
+						promise.set_value(std::invoke(function, std::forward<decltype(arguments)>(arguments)...));
+					}
+				}, std::move(arguments));
+			} catch (...) {
+				promise.set_exception(std::current_exception());
+			}
+		});
+	}
+
+	template<typename return_type, typename function_type, typename... args_types>
+	task make_task(std::promise<return_type>&& promise, function_type&& function, args_types&&... args) {
+		return make_guarded_task(no_cancellation(), std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...);
+	}
+
+	template<typename return_type, typename function_type, typename... args_types>
+	task make_task(const cancellation_token& token, std::promise<return_type>&& promise, function_type&& function, args_types&&... args) {
+		return make_guarded_task(token, std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...);
+	}
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "task.h"
+#include "thread_pool.h"
+#include "wait_strategy.h"
+
+namespace parallel_tools {
+	template<typename value_type>
+	class future_state {
+		private:
+			using stored_type = typename std::conditional<std::is_void<value_type>::value, std::monostate, value_type>::type;
+
+			std::mutex mutex;
+			std::atomic<bool> ready;
+			std::optional<stored_type> value;
+			std::exception_ptr exception;
+			std::vector<task> continuations;
+			thread_parker<wait_strategy::spin_then_park> waiting_threads;
+			thread_pool* const pool;
+
+			void finish(std::unique_lock<std::mutex>& lock) {
+				ready.store(true, std::memory_order_release);
+				auto ready_continuations = std::move(continuations);
+				lock.unlock();
+				waiting_threads.notify_all();
+				for (auto& continuation : ready_continuations) {
+					continuation();
+				}
+			}
+
+		public:
+			explicit future_state(thread_pool* pool) :
+				ready(false),
+				pool(pool)
+			{}
+
+			template<typename... args_types>
+			void set_value(args_types&&... args) {
+				std::unique_lock lock(mutex);
+				value.emplace(std::forward<args_types>(args)...);
+				finish(lock);
+			}
+
+			void set_exception(std::exception_ptr exception) {
+				std::unique_lock lock(mutex);
+				this->exception = exception;
+				finish(lock);
+			}
+
+			template<typename function_type, typename... args_types>
+			void fulfill(function_type& function, args_types&&... args) {
+				try {
+					if constexpr (std::is_void<value_type>::value) {
+						std::invoke(function, std::forward<args_types>(args)...);
+						set_value();
+					} else {
+						set_value(std::invoke(function, std::forward<args_types>(args)...));
+					}
+				} catch (...) {
+					set_exception(std::current_exception());
+				}
+			}
+
+			bool add_continuation(task&& continuation) {
+				std::lock_guard lock(mutex);
+				if (ready.load(std::memory_order_relaxed)) {
+					return false;
+				}
+				continuations.emplace_back(std::move(continuation));
+				return true;
+			}
+
+			void on_ready(task&& continuation) {
+				if (!add_continuation(std::move(continuation))) {
+					continuation();
+				}
+			}
+
+			bool is_ready() const {
+				return ready.load(std::memory_order_acquire);
+			}
+
+			void wait() {
+				if (pool && pool->is_worker_thread()) {
+					pool->help_until([&] {
+						return is_ready();
+					});
+					return;
+				}
+				waiting_threads.wait([&] {
+					return is_ready();
+				});
+			}
+
+			const stored_type& get() {
+				wait();
+				if (exception) {
+					std::rethrow_exception(exception);
+				}
+				return *value;
+			}
+
+			std::exception_ptr get_exception() const {
+				return exception;
+			}
+
+			thread_pool* get_pool() const {
+				return pool;
+			}
+	};
+
+	template<typename value_type>
+	class promised_state {
+		private:
+			std::shared_ptr<future_state<value_type>> state;
+
+		public:
+			explicit promised_state(std::shared_ptr<future_state<value_type>> state) :
+				state(std::move(state))
+			{}
+
+			promised_state(promised_state&& other) noexcept = default;
+			promised_state& operator=(promised_state&&) = delete;
+
+			~promised_state() {
+				if (state && !state->is_ready()) {
+					state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+				}
+			}
+
+			future_state<value_type>* operator->() const {
+				return state.get();
+			}
+	};
+
+	template<typename function_type, typename value_type>
+	struct continuation_result_of : std::invoke_result<function_type, const value_type&> {};
+	template<typename function_type>
+	struct continuation_result_of<function_type, void> : std::invoke_result<function_type> {};
+
+	template<typename value_type>
+	class task_future {
+		private:
+			std::shared_ptr<future_state<value_type>> state;
+
+			template<typename function_type>
+			using continuation_result = typename continuation_result_of<function_type, value_type>::type;
+
+			template<typename return_type, typename function_type>
+			task_future<return_type> continue_on(thread_pool* pool, function_type&& function) const {
+				auto continuation_state = std::make_shared<future_state<return_type>>(pool);
+				state->on_ready([
+					pool,
+					state = state,
+					continuation_state = promised_state<return_type>(continuation_state),
+					function = std::forward<function_type>(function)
+				] () mutable {
+					if (auto exception = state->get_exception()) {
+						continuation_state->set_exception(exception);
+						return;
+					}
+					auto continuation = [state = std::move(state), continuation_state = std::move(continuation_state), function = std::move(function)] () mutable {
+						if constexpr (std::is_void<value_type>::value) {
+							continuation_state->fulfill(function);
+						} else {
+							continuation_state->fulfill(function, state->get());
+						}
+					};
+					if (pool) {
+						pool->post(std::move(continuation));
+					} else {
+						continuation();
+					}
+				});
+				return task_future<return_type>(std::move(continuation_state));
+			}
+
+		public:
+			task_future() = default;
+
+			explicit task_future(std::shared_ptr<future_state<value_type>> state) :
+				state(std::move(state))
+			{}
+
+			bool valid() const {
+				return state != nullptr;
+			}
+
+			bool is_ready() const {
+				return state->is_ready();
+			}
+
+			void wait() const {
+				state->wait();
+			}
+
+			decltype(auto) get() const {
+				if constexpr (std::is_void<value_type>::value) {
+					state->get();
+				} else {
+					return state->get();
+				}
+			}
+
+			void on_ready(task&& continuation) const {
+				state->on_ready(std::move(continuation));
+			}
+
+			bool add_continuation(task&& continuation) const {
+				return state->add_continuation(std::move(continuation));
+			}
+
+			template<typename function_type, typename return_type = continuation_result<typename std::decay<function_type>::type>>
+			task_future<return_type> then(thread_pool& pool, function_type&& function) const {
+				return continue_on<return_type>(&pool, std::forward<function_type>(function));
+			}
+
+			template<typename function_type, typename return_type = continuation_result<typename std::decay<function_type>::type>>
+			task_future<return_type> then(function_type&& function) const {
+				return continue_on<return_type>(state->get_pool(), std::forward<function_type>(function));
+			}
+
+			thread_pool* get_pool() const {
+				return state->get_pool();
+			}
+	};
+
+	template<typename function_type, typename... args_types>
+	auto async(thread_pool& pool, function_type&& function, args_types&&... args) {
+		using return_type = typename std::invoke_result<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::type;
+		auto state = std::make_shared<future_state<return_type>>(&pool);
+		pool.post([
+			state = promised_state<return_type>(state),
+			function = std::forward<function_type>(function),
+			arguments = std::make_tuple(std::forward<args_types>(args)...)
+		] () mutable {
+			std::apply([&](auto&... arguments) {
+				state->fulfill(function, std::move(arguments)...);
+			}, arguments);
+		});
+		return task_future<return_type>(std::move(state));
+	}
+
+	template<typename value_type>
+	task_future<std::vector<task_future<value_type>>> when_all(std::vector<task_future<value_type>> futures) {
+		using result_type = std::vector<task_future<value_type>>;
+		thread_pool* pool = futures.empty() ? nullptr : futures.front().get_pool();
+		auto state = std::make_shared<future_state<result_type>>(pool);
+		if (futures.empty()) {
+			state->set_value();
+			return task_future<result_type>(std::move(state));
+		}
+
+		struct combination {
+			std::atomic<size_t> remaining_futures;
+			result_type futures;
+		};
+		auto shared_combination = std::make_shared<combination>();
+		shared_combination->remaining_futures = futures.size();
+		shared_combination->futures = futures;
+		for (auto& future : futures) {
+			future.on_ready([state, shared_combination] {
+				if (--shared_combination->remaining_futures == 0) {
+					state->set_value(std::move(shared_combination->futures));
+				}
+			});
+		}
+		return task_future<result_type>(std::move(state));
+	}
+
+	template<typename... value_types>
+	task_future<std::tuple<task_future<value_types>...>> when_all(task_future<value_types>... futures) {
+		using result_type = std::tuple<task_future<value_types>...>;
+		thread_pool* pools[] = {nullptr, futures.get_pool()...};
+		auto state = std::make_shared<future_state<result_type>>(pools[sizeof...(value_types) > 0 ? 1 : 0]);
+		if constexpr (sizeof...(value_types) == 0) {
+			state->set_value();
+			return task_future<result_type>(std::move(state));
+		}
+
+		struct combination {
+			std::atomic<size_t> remaining_futures;
+			result_type futures;
+		};
+		auto shared_combination = std::make_shared<combination>();
+		shared_combination->remaining_futures = sizeof...(value_types);
+		shared_combination->futures = result_type(futures...);
+		(futures.on_ready([state, shared_combination] {
+			if (--shared_combination->remaining_futures == 0) {
+				state->set_value(std::move(shared_combination->futures));
+			}
+		}), ...);
+		return task_future<result_type>(std::move(state));
+	}
+
+	template<typename value_type>
+	struct when_any_result {
+		size_t index;
+		std::vector<task_future<value_type>> futures;
+	};
+
+	template<typename value_type>
+	task_future<when_any_result<value_type>> when_any(std::vector<task_future<value_type>> futures) {
+		using result_type = when_any_result<value_type>;
+		thread_pool* pool = futures.empty() ? nullptr : futures.front().get_pool();
+		auto state = std::make_shared<future_state<result_type>>(pool);
+		if (futures.empty()) {
+			state->set_value(result_type{static_cast<size_t>(-1), {}});
+			return task_future<result_type>(std::move(state));
+		}
+
+		struct combination {
+			std::atomic<bool> finished;
+			std::vector<task_future<value_type>> futures;
+		};
+		auto shared_combination = std::make_shared<combination>();
+		shared_combination->finished = false;
+		shared_combination->futures = futures;
+		for (size_t index = 0; index < futures.size(); index++) {
+			futures[index].on_ready([state, shared_combination, index] {
+				if (!shared_combination->finished.exchange(true)) {
+					state->set_value(result_type{index, std::move(shared_combination->futures)});
+				}
+			});
+		}
+		return task_future<result_type>(std::move(state));
+	}
+}
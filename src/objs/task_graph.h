@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "task_future.h"
+#include "thread_pool.h"
+
+namespace parallel_tools {
+	class task_graph_cycle : public std::runtime_error {
+		public:
+			task_graph_cycle() :
+				std::runtime_error("task_graph has a cycle of dependencies")
+			{}
+	};
+
+	class task_graph {
+		private:
+			struct graph_node {
+				std::function<void()> function;
+				std::vector<size_t> successors;
+				size_t predecessors;
+			};
+
+			class execution {
+				private:
+					const std::shared_ptr<const std::vector<graph_node>> nodes;
+					const std::unique_ptr<std::atomic<size_t>[]> remaining_predecessors;
+					std::atomic<size_t> remaining_nodes;
+					std::atomic<bool> failed;
+					std::exception_ptr first_exception;
+					const std::shared_ptr<future_state<void>> completion;
+					thread_pool& pool;
+
+				public:
+					execution(std::shared_ptr<const std::vector<graph_node>> nodes, std::shared_ptr<future_state<void>> completion, thread_pool& pool) :
+						nodes(std::move(nodes)),
+						remaining_predecessors(new std::atomic<size_t>[this->nodes->size()]),
+						remaining_nodes(this->nodes->size()),
+						failed(false),
+						completion(std::move(completion)),
+						pool(pool)
+					{
+						for (size_t index = 0; index < this->nodes->size(); index++) {
+							remaining_predecessors[index] = (*this->nodes)[index].predecessors;
+						}
+					}
+
+					~execution() {
+						if (!completion->is_ready()) {
+							completion->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+						}
+					}
+
+					static void execute(const std::shared_ptr<execution>& graph_execution, size_t index) {
+						auto& self = *graph_execution;
+						for (bool executing = true; executing;) {
+							auto& node = (*self.nodes)[index];
+							if (!self.failed.load(std::memory_order_relaxed)) {
+								try {
+									node.function();
+								} catch (...) {
+									if (!self.failed.exchange(true)) {
+										self.first_exception = std::current_exception();
+									}
+								}
+							}
+
+							executing = false;
+							for (auto successor : node.successors) {
+								if (--self.remaining_predecessors[successor] == 0) {
+									if (!executing) {
+										executing = true;
+										index = successor;
+									} else {
+										self.pool.post([graph_execution, successor] {
+											execute(graph_execution, successor);
+										});
+									}
+								}
+							}
+
+							if (--self.remaining_nodes == 0) {
+								if (self.first_exception) {
+									self.completion->set_exception(self.first_exception);
+								} else {
+									self.completion->set_value();
+								}
+							}
+						}
+					}
+			};
+
+			std::vector<graph_node> nodes;
+
+			void check_for_cycles() const {
+				std::vector<size_t> remaining_predecessors;
+				std::vector<size_t> ready_nodes;
+				for (size_t index = 0; index < nodes.size(); index++) {
+					remaining_predecessors.push_back(nodes[index].predecessors);
+					if (nodes[index].predecessors == 0) {
+						ready_nodes.push_back(index);
+					}
+				}
+
+				size_t sorted_nodes = 0;
+				while (!ready_nodes.empty()) {
+					auto index = ready_nodes.back();
+					ready_nodes.pop_back();
+					sorted_nodes++;
+					for (auto successor : nodes[index].successors) {
+						if (--remaining_predecessors[successor] == 0) {
+							ready_nodes.push_back(successor);
+						}
+					}
+				}
+
+				if (sorted_nodes != nodes.size()) {
+					throw task_graph_cycle();
+				}
+			}
+
+		public:
+			struct node {
+				size_t index;
+			};
+
+			template<typename function_type>
+			node add(function_type&& function) {
+				nodes.push_back(graph_node{std::forward<function_type>(function), {}, 0});
+				return node{nodes.size() - 1};
+			}
+
+			template<typename function_type>
+			node add(function_type&& function, std::initializer_list<node> dependencies) {
+				auto added_node = add(std::forward<function_type>(function));
+				for (auto dependency : dependencies) {
+					precede(dependency, added_node);
+				}
+				return added_node;
+			}
+
+			void precede(node before, node after) {
+				nodes[before.index].successors.push_back(after.index);
+				nodes[after.index].predecessors++;
+			}
+
+			size_t size() const {
+				return nodes.size();
+			}
+
+			task_future<void> run(thread_pool& pool) const {
+				check_for_cycles();
+
+				auto completion = std::make_shared<future_state<void>>(&pool);
+				if (nodes.empty()) {
+					completion->set_value();
+					return task_future<void>(std::move(completion));
+				}
+
+				auto graph_execution = std::make_shared<execution>(std::make_shared<const std::vector<graph_node>>(nodes), completion, pool);
+				std::vector<std::function<void()>> roots;
+				for (size_t index = 0; index < nodes.size(); index++) {
+					if (nodes[index].predecessors == 0) {
+						roots.emplace_back([graph_execution, index] {
+							execution::execute(graph_execution, index);
+						});
+					}
+				}
+				pool.post_bulk(std::move(roots));
+				return task_future<void>(std::move(completion));
+			}
+	};
+}
@@ -1,57 +1,638 @@
 #include "thread_pool.h"
 
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
 using namespace std;
 using namespace parallel_tools;
 
+namespace {
+	template<bool enabled = metrics_enabled>
+	struct worker_metrics {
+		pool_metrics<>::worker_counters* counters;
+
+		constexpr worker_metrics(pool_metrics<>::worker_counters* counters) :
+			counters(counters)
+		{}
+	};
+
+	template<>
+	struct worker_metrics<false> {
+		static constexpr pool_metrics<>::worker_counters* counters = nullptr;
+
+		constexpr worker_metrics(pool_metrics<>::worker_counters*) {}
+	};
+
+	struct worker_identity : worker_metrics<> {
+		const thread_pool* pool;
+		size_t index;
+		trace_buffer* trace;
+
+		constexpr worker_identity(const thread_pool* pool, size_t index, pool_metrics<>::worker_counters* counters, trace_buffer* trace) :
+			worker_metrics(counters),
+			pool(pool),
+			index(index),
+			trace(trace)
+		{}
+	};
+
+	thread_local worker_identity current_worker = {nullptr, 0, nullptr, nullptr};
+	thread_local minstd_rand victim_generator(hash<thread::id>()(this_thread::get_id()));
+
+	task* store_task(task&& scheduled_task) {
+		auto stored_task = pooled_allocator<task>().allocate(1);
+		new (stored_task) task(std::move(scheduled_task));
+		return stored_task;
+	}
+
+	chrono::steady_clock::time_point metrics_clock() {
+		if constexpr (metrics_enabled) {
+			return chrono::steady_clock::now();
+		} else {
+			return {};
+		}
+	}
+
+	int64_t tracing_clock() {
+		if constexpr (tracing_enabled) {
+			return trace_clock();
+		} else {
+			return 0;
+		}
+	}
+
+	task release_task(task* stored_task) {
+		task released_task(std::move(*stored_task));
+		stored_task->~task();
+		pooled_allocator<task>().deallocate(stored_task, 1);
+		return released_task;
+	}
+}
+
 void thread_pool::init_threads(unsigned number_of_threads) {
+	stopping = false;
+	queued_tasks = 0;
+	live_threads = 0;
+	threads_to_retire = 0;
 	threads.reserve(number_of_threads);
 	for (decltype(number_of_threads) i = 0; i < number_of_threads; i++) {
-		threads.emplace_back([this] {
-			while(running) {
-				auto current_task = task_queue.consume();
-				current_task();
+		spawn_thread();
+	}
+}
+
+void thread_pool::apply_worker_options(const worker_options& options) {
+	worker_cpus = place_workers(options, cpu_topology::read());
+	worker_name = options.name;
+}
+
+void thread_pool::apply_options(unsigned number_of_threads, const thread_pool_options& options) {
+	apply_worker_options(options.workers);
+	visit([&](const auto& queue, const auto& strategy) {
+		using queue_type = typename decay<decltype(queue)>::type;
+		using wait_strategy_type = typename decay<decltype(strategy)>::type::type;
+		if constexpr (is_same<queue_type, work_stealing>::value) {
+			task_queue.reset(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>());
+			init_local_queues(number_of_threads);
+		} else {
+			task_queue.reset(new task_queue_adapter<queue_type, wait_strategy_type>(queue));
+		}
+	}, options.queue, options.wait);
+}
+
+void thread_pool::init_local_queues(unsigned number_of_threads) {
+	local_queues.reserve(number_of_threads);
+	for (decltype(number_of_threads) i = 0; i < number_of_threads; i++) {
+		local_queues.emplace_back(new work_stealing_deque<task_type*>());
+	}
+}
+
+void thread_pool::configure_worker(size_t worker_index) {
+	if (!worker_cpus.empty()) {
+		pin_current_thread(worker_cpus[worker_index % worker_cpus.size()]);
+	}
+	if (!worker_name.empty()) {
+		name_current_thread(worker_name + "-" + to_string(worker_index));
+	}
+}
+
+size_t thread_pool::claim_worker_index() {
+	auto free_index = find(used_worker_indices.begin(), used_worker_indices.end(), false);
+	if (free_index == used_worker_indices.end()) {
+		used_worker_indices.push_back(true);
+		return used_worker_indices.size() - 1;
+	}
+	*free_index = true;
+	return free_index - used_worker_indices.begin();
+}
+
+void thread_pool::spawn_thread() {
+	auto worker_index = claim_worker_index();
+	live_threads++;
+	auto counters = metrics().register_worker(worker_index);
+	auto trace = tracer().register_worker(worker_name, worker_index);
+	threads.emplace_back([this, worker_index, counters, trace] {
+		configure_worker(worker_index);
+		current_worker = {this, worker_index, counters, trace};
+		current_trace_buffer() = trace;
+		if (local_queues.empty()) {
+			consume_shared_queue();
+		} else {
+			consume_with_work_stealing(worker_index);
+		}
+		metrics().retire_worker(counters);
+		tracer().retire_worker(trace);
+		current_trace_buffer() = nullptr;
+		current_worker = {nullptr, 0, nullptr, nullptr};
+	});
+}
+
+bool thread_pool::retire_thread(unsigned minimum_threads) {
+	auto current_threads = live_threads.load();
+	while (current_threads > minimum_threads) {
+		if (live_threads.compare_exchange_weak(current_threads, current_threads - 1)) {
+			lock_guard lock(threads_mutex);
+			retired_threads.emplace_back(this_thread::get_id(), current_worker.index);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool thread_pool::retire_requested_thread() {
+	auto requested_retirements = threads_to_retire.load();
+	while (requested_retirements > 0) {
+		if (threads_to_retire.compare_exchange_weak(requested_retirements, requested_retirements - 1)) {
+			return retire_thread(0);
+		}
+	}
+	return false;
+}
+
+void thread_pool::reap_retired_threads() {
+	for (auto& [retired_thread, worker_index] : retired_threads) {
+		auto thread = find_if(threads.begin(), threads.end(), [&](const std::thread& thread) {
+			return thread.get_id() == retired_thread;
+		});
+		if (thread != threads.end()) {
+			thread->join();
+			threads.erase(thread);
+			used_worker_indices[worker_index] = false;
+		}
+	}
+	retired_threads.clear();
+}
+
+void thread_pool::grow_if_backlogged() {
+	if (live_threads >= elasticity->maximum_threads || task_queue->get_queued_tasks() <= elasticity->spawn_threshold) {
+		return;
+	}
+	unique_lock lock(threads_mutex, try_to_lock);
+	if (lock.owns_lock() && !stopping && live_threads < elasticity->maximum_threads) {
+		reap_retired_threads();
+		spawn_thread();
+	}
+}
+
+void thread_pool::consume_shared_queue() {
+	function<bool()> retirement_requested = [this] {
+		return threads_to_retire > 0;
+	};
+	while (true) {
+		auto deadline = elasticity
+			? chrono::steady_clock::now() + elasticity->keep_alive
+			: chrono::steady_clock::time_point::max();
+		auto current_task = task_queue->consume_until(deadline, retirement_requested);
+		if (!current_task) {
+			if (threads_to_retire > 0 && retire_requested_thread()) {
+				return;
+			}
+			if (task_queue->is_closed() && task_queue->get_queued_tasks() == 0) {
+				break;
 			}
+			if (elasticity && chrono::steady_clock::now() >= deadline && retire_thread(elasticity->minimum_threads)) {
+				return;
+			}
+			continue;
+		}
+		if (!running) {
+			break;
+		}
+		run_task(*current_task);
+		if (threads_to_retire > 0 && retire_requested_thread()) {
+			return;
+		}
+	}
+}
+
+void thread_pool::consume_with_work_stealing(size_t worker_index) {
+	while (running) {
+		if (auto current_task = find_task(worker_index)) {
+			queued_tasks--;
+			if (!running) {
+				break;
+			}
+			run_task(*current_task);
+			continue;
+		}
+		if (stopping && queued_tasks <= 0) {
+			break;
+		}
+		idle_workers.wait([this] {
+			return queued_tasks > 0 || stopping || !running;
 		});
 	}
 }
+
+optional<thread_pool::task_type> thread_pool::find_task(size_t worker_index) {
+	auto task = local_queues[worker_index]->take();
+	if (!task && local_queues.size() > 1) {
+		auto first_victim = victim_generator();
+		for (size_t i = 0; !task && i < local_queues.size(); i++) {
+			auto victim = (first_victim + i) % local_queues.size();
+			if (victim != worker_index) {
+				task = local_queues[victim]->steal();
+			}
+		}
+	}
+	if (task) {
+		return release_task(*task);
+	}
+	return task_queue->try_consume();
+}
+
+void thread_pool::drop_local_tasks() {
+	for (auto& local_queue : local_queues) {
+		while (auto task = local_queue->take()) {
+			release_task(*task);
+		}
+	}
+}
+
+pool_metrics<>& thread_pool::metrics() {
+	return *this;
+}
+
+trace_recorder<>& thread_pool::tracer() {
+	return *this;
+}
+
+void thread_pool::instrument(task_type& task) {
+	task.set_enqueue_stamp({metrics_clock(), tracing_clock()});
+}
+
+void thread_pool::record_task(const task_type& task, chrono::steady_clock::time_point started, int64_t started_tick) {
+	auto finished_tick = tracing_clock();
+	auto finished = metrics_clock();
+	auto stamp = task.get_enqueue_stamp();
+	auto worker = current_worker.pool == this ? current_worker : worker_identity(nullptr, 0, nullptr, nullptr);
+	if (stamp.time != chrono::steady_clock::time_point()) {
+		metrics().record_task(worker.counters, stamp.time, started, finished);
+	}
+	if (worker.trace && stamp.tick != 0) {
+		worker.trace->record(trace_event_type::task, started_tick, finished_tick, stamp.tick);
+	}
+}
+
+void thread_pool::run_task(task_type& task) {
+	if constexpr (metrics_enabled || tracing_enabled) {
+		auto started = metrics_clock();
+		auto started_tick = tracing_clock();
+		exception_ptr exception;
+		try {
+			task();
+		} catch (...) {
+			exception = current_exception();
+		}
+		record_task(task, started, started_tick);
+		if (exception) {
+			handle_exception(exception);
+		}
+	} else {
+		try {
+			task();
+		} catch (...) {
+			handle_exception(current_exception());
+		}
+	}
+	wake_helpers();
+}
+
+void thread_pool::wake_helpers() {
+	if (parked_helpers.get_waiting_threads() > 0) {
+		helper_wake_ups++;
+		parked_helpers.notify_all();
+	}
+}
+
+void thread_pool::handle_exception(exception_ptr exception) {
+	function<void(exception_ptr)> handler;
+	{
+		lock_guard lock(exception_handler_mutex);
+		handler = exception_handler;
+	}
+	if (handler) {
+		handler(exception);
+	}
+}
+
+void thread_pool::schedule(task_type&& task) {
+	if constexpr (metrics_enabled || tracing_enabled) {
+		instrument(task);
+	}
+	if (local_queues.empty()) {
+		task_queue->produce(std::move(task));
+		if (elasticity) {
+			grow_if_backlogged();
+		}
+		wake_helpers();
+		return;
+	}
+	if (current_worker.pool == this) {
+		local_queues[current_worker.index]->push(store_task(std::move(task)));
+	} else if (!task_queue->produce(std::move(task))) {
+		return;
+	}
+	queued_tasks++;
+	idle_workers.notify_one();
+	wake_helpers();
+}
+
+void thread_pool::schedule_bulk(vector<task_type>&& tasks) {
+	if constexpr (metrics_enabled || tracing_enabled) {
+		for (auto& task : tasks) {
+			instrument(task);
+		}
+	}
+	if (local_queues.empty()) {
+		task_queue->produce_bulk(std::move(tasks));
+		if (elasticity) {
+			grow_if_backlogged();
+		}
+		wake_helpers();
+		return;
+	}
+	long scheduled_tasks = tasks.size();
+	if (current_worker.pool == this) {
+		for (auto& task : tasks) {
+			local_queues[current_worker.index]->push(store_task(std::move(task)));
+		}
+	} else {
+		scheduled_tasks = task_queue->produce_bulk(std::move(tasks));
+	}
+	queued_tasks += scheduled_tasks;
+	idle_workers.notify_all();
+	wake_helpers();
+}
+
+void thread_pool::schedule(task_type&& task, priority level) {
+	if (local_queues.empty()) {
+		if constexpr (metrics_enabled || tracing_enabled) {
+			instrument(task);
+		}
+		task_queue->produce(std::move(task), level);
+		if (elasticity) {
+			grow_if_backlogged();
+		}
+		wake_helpers();
+		return;
+	}
+	schedule(std::move(task));
+}
 thread_pool::thread_pool(unsigned number_of_threads) :
-	running(true)
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>())
 {
 	init_threads(number_of_threads);
 }
 
 thread_pool::thread_pool(unsigned number_of_threads, const flush_policy::batches_of& batches) :
 	running(true),
-	task_queue(batches)
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>(batches))
 {
 	init_threads(number_of_threads);
 }
 
 thread_pool::thread_pool(unsigned number_of_threads, const flush_policy::maximum_waiting_consumers& waiting_threads) :
 	running(true),
-	task_queue(waiting_threads)
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>(waiting_threads))
+{
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const flush_policy::max_latency& latency) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>(latency))
+{
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const flush_policy::adaptive& adaptive) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>(adaptive))
+{
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const queue_backend::double_buffer& buffer) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>(buffer))
 {
 	init_threads(number_of_threads);
 }
 
+thread_pool::thread_pool(unsigned number_of_threads, const queue_backend::ring_buffer& ring) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::ring_buffer>(ring))
+{
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const queue_backend::priority_levels& priority_levels) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::priority_levels>(priority_levels))
+{
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const work_stealing&) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>())
+{
+	init_local_queues(number_of_threads);
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(const elastic& elastic_threads) :
+	running(true),
+	task_queue(new task_queue_adapter<queue_backend::double_buffer>()),
+	elasticity(elastic_threads)
+{
+	elasticity->minimum_threads = max(elasticity->minimum_threads, 1u);
+	elasticity->maximum_threads = max(elasticity->maximum_threads, elasticity->minimum_threads);
+	init_threads(elasticity->minimum_threads);
+}
+
+thread_pool::thread_pool(unsigned number_of_threads, const thread_pool_options& options) :
+	running(true)
+{
+	apply_options(number_of_threads, options);
+	init_threads(number_of_threads);
+}
+
+thread_pool::thread_pool(const elastic& elastic_threads, const thread_pool_options& options) :
+	running(true),
+	elasticity(elastic_threads)
+{
+	if (holds_alternative<work_stealing>(options.queue)) {
+		throw logic_error("work stealing pools can't be elastic");
+	}
+	apply_options(0, options);
+	elasticity->minimum_threads = max(elasticity->minimum_threads, 1u);
+	elasticity->maximum_threads = max(elasticity->maximum_threads, elasticity->minimum_threads);
+	init_threads(elasticity->minimum_threads);
+}
+
 thread_pool::~thread_pool() {
 	if (is_running()) {
 		terminate();
 	}
 }
 
-void thread_pool::terminate() {
-	running = false;
-	for (size_t i = 0; i < threads.size(); i++) {
-		exec([]{});
+void thread_pool::join_threads() {
+	vector<std::thread> joined_threads;
+	{
+		lock_guard lock(threads_mutex);
+		joined_threads = std::move(threads);
+		retired_threads.clear();
+		used_worker_indices.clear();
+	}
+	for (auto& thread : joined_threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
 	}
+}
 
-	for (auto& thread : threads) {
-		thread.join();
+void thread_pool::stop_timers() {
+	lock_guard lock(threads_mutex);
+	if (timers) {
+		timers->stop();
 	}
 }
 
+timer_wheel& thread_pool::get_timers() {
+	call_once(timers_created, [this] {
+		lock_guard lock(threads_mutex);
+		timers.reset(new timer_wheel([this](vector<task_type>&& expired_tasks) {
+			schedule_bulk(std::move(expired_tasks));
+		}));
+	});
+	return *timers;
+}
+
+void thread_pool::shutdown() {
+	stop_timers();
+	{
+		lock_guard lock(threads_mutex);
+		stopping = true;
+	}
+	task_queue->close();
+	idle_workers.notify_all();
+	join_threads();
+	running = false;
+	wake_helpers();
+}
+
+void thread_pool::shutdown_now() {
+	stop_timers();
+	running = false;
+	{
+		lock_guard lock(threads_mutex);
+		stopping = true;
+	}
+	task_queue->close();
+	idle_workers.notify_all();
+	join_threads();
+	while (task_queue->try_consume());
+	drop_local_tasks();
+}
+
+void thread_pool::terminate() {
+	shutdown_now();
+}
+
 bool thread_pool::is_running() const {
 	return running;
 }
 
+unsigned thread_pool::get_number_of_threads() const {
+	return live_threads;
+}
+
+void thread_pool::write_trace(ostream& output) {
+	tracer().write_chrome_trace(output);
+}
+
+pool_metrics_snapshot thread_pool::get_metrics() {
+	auto snapshot = metrics().snapshot();
+	snapshot.queue = task_queue->get_metrics();
+	return snapshot;
+}
+
+bool thread_pool::is_worker_thread() const {
+	return current_worker.pool == this;
+}
+
+bool thread_pool::run_pending_task() {
+	if (!running) {
+		return false;
+	}
+	optional<task_type> pending_task;
+	if (!local_queues.empty()) {
+		pending_task = is_worker_thread() ? find_task(current_worker.index) : task_queue->try_consume();
+		if (pending_task) {
+			queued_tasks--;
+		}
+	} else {
+		pending_task = task_queue->try_consume();
+	}
+	if (!pending_task) {
+		return false;
+	}
+	run_task(*pending_task);
+	return true;
+}
+
+void thread_pool::set_exception_handler(function<void(exception_ptr)> handler) {
+	lock_guard lock(exception_handler_mutex);
+	exception_handler = std::move(handler);
+}
+
+void thread_pool::resize(unsigned number_of_threads) {
+	if (!local_queues.empty()) {
+		throw logic_error("work stealing pools can't be resized");
+	}
+	number_of_threads = max(number_of_threads, 1u);
+	if (elasticity) {
+		number_of_threads = clamp(number_of_threads, elasticity->minimum_threads, elasticity->maximum_threads);
+	}
+
+	lock_guard lock(threads_mutex);
+	if (stopping) {
+		return;
+	}
+	reap_retired_threads();
+	unsigned remaining_threads = live_threads - threads_to_retire;
+	if (number_of_threads > remaining_threads) {
+		auto cancelled_retirements = min(threads_to_retire.load(), number_of_threads - remaining_threads);
+		threads_to_retire -= cancelled_retirements;
+		for (auto i = remaining_threads + cancelled_retirements; i < number_of_threads; i++) {
+			spawn_thread();
+		}
+	} else {
+		threads_to_retire += remaining_threads - number_of_threads;
+		task_queue->wake_consumers();
+	}
+}
+
@@ -5,52 +5,564 @@
 #include <future>
 #include <queue>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <chrono>
+#include <tuple>
+#include <iterator>
+#include <vector>
+#include <exception>
+#include <string>
+#include <variant>
 
+#include "cancellation.h"
+#include "cpu_topology.h"
+#include "metrics.h"
+#include "pooled_allocator.h"
 #include "production_queue.h"
+#include "task.h"
+#include "timer_wheel.h"
+#include "tracing.h"
+#include "wait_strategy.h"
+#include "work_stealing_deque.h"
 
 namespace parallel_tools {
-	class thread_pool {
+	struct work_stealing {};
+
+	struct elastic {
+		unsigned minimum_threads;
+		unsigned maximum_threads;
+		size_t spawn_threshold = 1;
+		std::chrono::steady_clock::duration keep_alive = std::chrono::seconds(1);
+	};
+
+	template<typename wait_strategy_type>
+	struct wait_strategy_tag {
+		using type = wait_strategy_type;
+	};
+
+	struct thread_pool_options {
+		std::variant<queue_backend::double_buffer, queue_backend::ring_buffer, queue_backend::priority_levels, work_stealing> queue;
+		std::variant<
+			wait_strategy_tag<wait_strategy::blocking>,
+			wait_strategy_tag<wait_strategy::spin_then_park>,
+			wait_strategy_tag<wait_strategy::spin_then_yield>,
+			wait_strategy_tag<wait_strategy::busy_spin>
+		> wait;
+		worker_options workers;
+	};
+
+	class thread_pool : private pool_metrics<>, private trace_recorder<> {
 		private:
-			volatile bool running;
-			production_queue<std::packaged_task<void()>> task_queue;
+			using task_type = task;
+
+			class task_queue_interface {
+				public:
+					virtual ~task_queue_interface() = default;
+					virtual bool produce(task_type&& task) = 0;
+					virtual bool produce(task_type&& task, priority level) = 0;
+					virtual size_t produce_bulk(std::vector<task_type>&& tasks) = 0;
+					virtual std::optional<task_type> try_consume() = 0;
+					virtual std::optional<task_type> consume_until(std::chrono::steady_clock::time_point deadline, const std::function<bool()>& stop) = 0;
+					virtual void wake_consumers() = 0;
+					virtual void close() = 0;
+					virtual bool is_closed() const = 0;
+					virtual size_t get_queued_tasks() = 0;
+					virtual queue_metrics_snapshot get_metrics() = 0;
+			};
+
+			template<typename backend, typename wait_strategy_type = typename backend::default_wait_strategy>
+			class task_queue_adapter : public task_queue_interface {
+				private:
+					production_queue<task_type, backend, wait_strategy_type> queue;
+
+				public:
+					template<typename... args_types>
+					task_queue_adapter(args_types&&... args) :
+						queue(std::forward<args_types>(args)...)
+					{}
+
+					bool produce(task_type&& task) override {
+						return queue.produce(std::move(task));
+					}
+
+					bool produce(task_type&& task, priority level) override {
+						if constexpr (std::is_same<backend, queue_backend::priority_levels>::value) {
+							return queue.produce(level, std::move(task));
+						} else {
+							return queue.produce(std::move(task));
+						}
+					}
+
+					size_t produce_bulk(std::vector<task_type>&& tasks) override {
+						if constexpr (std::is_same<backend, queue_backend::double_buffer>::value) {
+							return queue.produce_bulk(std::move(tasks));
+						} else {
+							size_t produced_tasks = 0;
+							for (auto& task : tasks) {
+								if (!queue.produce(std::move(task))) {
+									break;
+								}
+								produced_tasks++;
+							}
+							return produced_tasks;
+						}
+					}
+
+					std::optional<task_type> try_consume() override {
+						return queue.try_consume();
+					}
+
+					std::optional<task_type> consume_until(std::chrono::steady_clock::time_point deadline, const std::function<bool()>& stop) override {
+						try {
+							return queue.consume_until(deadline, stop);
+						} catch (const queue_closed&) {
+							return std::nullopt;
+						}
+					}
+
+					void wake_consumers() override {
+						queue.wake_consumers();
+					}
+
+					void close() override {
+						queue.close();
+					}
+
+					bool is_closed() const override {
+						return queue.is_closed();
+					}
+
+					size_t get_queued_tasks() override {
+						return queue.get_available_resources() + queue.get_unpublished_resources();
+					}
+
+					queue_metrics_snapshot get_metrics() override {
+						if constexpr (std::is_same<backend, queue_backend::double_buffer>::value) {
+							return queue.get_metrics();
+						} else {
+							return {};
+						}
+					}
+			};
+
+			template<typename wait_strategy_type>
+			using enable_if_wait_strategy = typename std::enable_if<is_wait_strategy<wait_strategy_type>::value>::type;
+
+			std::atomic<bool> running;
+			std::atomic<bool> stopping;
+			std::unique_ptr<task_queue_interface> task_queue;
+			std::vector<std::unique_ptr<work_stealing_deque<task_type*>>> local_queues;
+			std::atomic<long> queued_tasks;
+			thread_parker<wait_strategy::spin_then_park> idle_workers;
+			thread_parker<wait_strategy::blocking> parked_helpers;
+			std::atomic<uint32_t> helper_wake_ups{0};
+			std::optional<elastic> elasticity;
+			std::atomic<unsigned> live_threads;
+			std::atomic<unsigned> threads_to_retire;
+			std::mutex threads_mutex;
 			std::vector<std::thread> threads;
+			std::vector<std::pair<std::thread::id, size_t>> retired_threads;
+			std::vector<bool> used_worker_indices;
+			std::vector<std::vector<unsigned>> worker_cpus;
+			std::string worker_name = worker_options().name;
+			std::once_flag timers_created;
+			std::unique_ptr<timer_wheel> timers;
+			std::mutex exception_handler_mutex;
+			std::function<void(std::exception_ptr)> exception_handler;
+
+			friend class serial_queue;
 
+			void apply_worker_options(const worker_options& options);
+			void apply_options(unsigned number_of_threads, const thread_pool_options& options);
+			size_t claim_worker_index();
+			void init_local_queues(unsigned number_of_threads);
 			void init_threads(unsigned number_of_threads);
+			void configure_worker(size_t worker_index);
+			void spawn_thread();
+			bool retire_thread(unsigned minimum_threads);
+			bool retire_requested_thread();
+			void reap_retired_threads();
+			void grow_if_backlogged();
+			void join_threads();
+			void stop_timers();
+			timer_wheel& get_timers();
+			void consume_shared_queue();
+			void consume_with_work_stealing(size_t worker_index);
+			std::optional<task_type> find_task(size_t worker_index);
+			void drop_local_tasks();
+			pool_metrics<>& metrics();
+			trace_recorder<>& tracer();
+			void instrument(task_type& task);
+			void record_task(const task_type& task, std::chrono::steady_clock::time_point started, int64_t started_tick);
+			void run_task(task_type& task);
+			void wake_helpers();
+			void handle_exception(std::exception_ptr exception);
+			void schedule(task_type&& task);
+			void schedule(task_type&& task, priority level);
+			void schedule_bulk(std::vector<task_type>&& tasks);
+
+			class task_group {
+				private:
+					std::atomic<size_t> remaining_tasks;
+					std::atomic<bool> failed;
+					std::exception_ptr first_exception;
+					std::promise<void> completion;
+
+				public:
+					task_group() :
+						remaining_tasks(0),
+						failed(false),
+						completion(std::allocator_arg, pooled_allocator<std::promise<void>>())
+					{}
+
+					std::future<void> get_future() {
+						return completion.get_future();
+					}
+
+					void expect(size_t number_of_tasks) {
+						remaining_tasks = number_of_tasks;
+						if (number_of_tasks == 0) {
+							completion.set_value();
+						}
+					}
+
+					void fail(std::exception_ptr exception) {
+						if (!failed.exchange(true)) {
+							first_exception = exception;
+						}
+					}
+
+					void finish_task() {
+						if (--remaining_tasks == 0) {
+							if (first_exception) {
+								completion.set_exception(first_exception);
+							} else {
+								completion.set_value();
+							}
+						}
+					}
+			};
+
+			template<typename iterator_type>
+			std::vector<task_type> make_grouped_tasks(iterator_type first, iterator_type last, const std::shared_ptr<task_group>& group, const cancellation_token& token = cancellation_token()) {
+				std::vector<task_type> tasks;
+				for (; first != last; ++first) {
+					tasks.emplace_back([group, token, function = *first] () mutable {
+						try {
+							token.throw_if_stop_requested();
+							function();
+						} catch (...) {
+							group->fail(std::current_exception());
+						}
+						group->finish_task();
+					});
+				}
+				return tasks;
+			}
+
+			template<typename function_type, typename... args_types>
+			static task_type make_timer_task(function_type&& function, args_types&&... args) {
+				return task_type([
+					function = std::forward<function_type>(function),
+					arguments = std::make_tuple(std::forward<args_types>(args)...)
+				] () mutable {
+					std::apply(function, arguments);
+				});
+			}
+
+			template<typename future_type>
+			static auto is_ready(const future_type& future, int) -> decltype(future.is_ready()) {
+				return future.is_ready();
+			}
+
+			template<typename future_type>
+			static bool is_ready(const future_type& future, long) {
+				return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}
 
 		public:
 			thread_pool(unsigned number_of_threads);
 			thread_pool(unsigned number_of_threads, const flush_policy::batches_of& batches);
 			thread_pool(unsigned number_of_threads, const flush_policy::maximum_waiting_consumers& waiting_threads);
+			thread_pool(unsigned number_of_threads, const flush_policy::max_latency& latency);
+			thread_pool(unsigned number_of_threads, const flush_policy::adaptive& adaptive);
+			thread_pool(unsigned number_of_threads, const queue_backend::double_buffer& buffer);
+			thread_pool(unsigned number_of_threads, const queue_backend::ring_buffer& ring);
+			thread_pool(unsigned number_of_threads, const queue_backend::priority_levels& priority_levels);
+			thread_pool(unsigned number_of_threads, const work_stealing&);
+			thread_pool(const elastic& elastic_threads);
+			thread_pool(unsigned number_of_threads, const thread_pool_options& options);
+			thread_pool(const elastic& elastic_threads, const thread_pool_options& options);
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>())
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const flush_policy::batches_of& batches, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>(batches))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const flush_policy::maximum_waiting_consumers& waiting_threads, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>(waiting_threads))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const flush_policy::max_latency& latency, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>(latency))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const flush_policy::adaptive& adaptive, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>(adaptive))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const queue_backend::double_buffer& buffer, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::double_buffer, wait_strategy_type>(buffer))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const queue_backend::ring_buffer& ring, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::ring_buffer, wait_strategy_type>(ring))
+			{
+				init_threads(number_of_threads);
+			}
+
+			template<typename wait_strategy_type, typename = enable_if_wait_strategy<wait_strategy_type>>
+			thread_pool(unsigned number_of_threads, const queue_backend::priority_levels& priority_levels, const wait_strategy_type&) :
+				running(true),
+				task_queue(new task_queue_adapter<queue_backend::priority_levels, wait_strategy_type>(priority_levels))
+			{
+				init_threads(number_of_threads);
+			}
 			~thread_pool();
 
+			void shutdown();
+			void shutdown_now();
 			void terminate();
 			bool is_running() const;
+			unsigned get_number_of_threads() const;
+			void resize(unsigned number_of_threads);
+			bool is_worker_thread() const;
+			bool run_pending_task();
+			void set_exception_handler(std::function<void(std::exception_ptr)> handler);
+			pool_metrics_snapshot get_metrics();
+			void write_trace(std::ostream& output);
+
+			template<typename predicate_type>
+			void help_until(const predicate_type& predicate) {
+				constexpr unsigned yields_before_parking = 16;
+				constexpr auto maximum_parking_time = std::chrono::milliseconds(1);
+				for (unsigned idle_attempts = 0; !predicate();) {
+					if (run_pending_task()) {
+						idle_attempts = 0;
+					} else if (idle_attempts++ < yields_before_parking) {
+						std::this_thread::yield();
+					} else {
+						auto wake_ups = helper_wake_ups.load();
+						parked_helpers.wait_until(std::chrono::steady_clock::now() + maximum_parking_time, [&] {
+							return helper_wake_ups.load() != wake_ups || predicate();
+						});
+					}
+				}
+			}
+
+			template<typename future_type>
+			void wait(const future_type& future) {
+				if (!is_worker_thread()) {
+					future.wait();
+					return;
+				}
+				help_until([&] {
+					return is_ready(future, 0);
+				});
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename return_type = typename std::result_of<typename std::decay<function_type>::type(typename std::decay<args_types>::type...)>::type
+			>
+			std::future<return_type> exec(function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
+
+				schedule(make_task(std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...));
+
+				return future;
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename return_type = typename std::result_of<typename std::decay<function_type>::type(typename std::decay<args_types>::type...)>::type
+			>
+			std::future<return_type> exec(priority level, function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
+
+				schedule(make_task(std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...), level);
+
+				return future;
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename return_type = typename std::result_of<typename std::decay<function_type>::type(typename std::decay<args_types>::type...)>::type
+			>
+			std::future<return_type> exec(const cancellation_token& token, function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
+
+				schedule(make_task(token, std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...));
+
+				return future;
+			}
 
 			template<
 				typename function_type,
 				typename... args_types,
-				typename return_type = typename std::result_of<function_type(args_types...)>::type
+				typename return_type = typename std::result_of<typename std::decay<function_type>::type(typename std::decay<args_types>::type...)>::type
 			>
-			std::future<return_type> exec(const function_type& task, args_types... args) {
-				std::packaged_task<return_type()> packaged_task(std::bind(task, args...));
-				auto future = packaged_task.get_future();
+			std::future<return_type> exec(priority level, const cancellation_token& token, function_type&& function, args_types&&... args) {
+				std::promise<return_type> promise(std::allocator_arg, pooled_allocator<std::promise<return_type>>());
+				auto future = promise.get_future();
 
-				task_queue.produce(std::move(packaged_task));
+				schedule(make_task(token, std::move(promise), std::forward<function_type>(function), std::forward<args_types>(args)...), level);
 
 				return future;
 			}
 
 			template<
 				typename function_type,
-				typename return_type = typename std::result_of<function_type()>::type
+				typename... args_types,
+				typename = typename std::enable_if<std::is_invocable<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::value>::type
+			>
+			void post(function_type&& function, args_types&&... args) {
+				schedule(make_posted_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<
+				typename function_type,
+				typename... args_types,
+				typename = typename std::enable_if<std::is_invocable<typename std::decay<function_type>::type, typename std::decay<args_types>::type...>::value>::type
 			>
-			std::future<return_type> exec(const function_type& task) {
-				std::packaged_task<return_type()> packaged_task(task);
-				auto future = packaged_task.get_future();
+			void post(priority level, function_type&& function, args_types&&... args) {
+				schedule(make_posted_task(std::forward<function_type>(function), std::forward<args_types>(args)...), level);
+			}
+
+			template<typename function_type, typename... args_types>
+			void post(const cancellation_token& token, function_type&& function, args_types&&... args) {
+				schedule(make_posted_task(token, std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<typename function_type, typename... args_types>
+			void post(priority level, const cancellation_token& token, function_type&& function, args_types&&... args) {
+				schedule(make_posted_task(token, std::forward<function_type>(function), std::forward<args_types>(args)...), level);
+			}
+
+			template<typename iterator_type>
+			void post_bulk(iterator_type first, iterator_type last) {
+				std::vector<task_type> tasks;
+				for (; first != last; ++first) {
+					tasks.emplace_back(make_posted_task(*first));
+				}
+				schedule_bulk(std::move(tasks));
+			}
 
-				task_queue.produce(std::move(packaged_task));
+			template<typename range_type>
+			void post_bulk(range_type&& functions) {
+				if constexpr (std::is_lvalue_reference<range_type>::value) {
+					post_bulk(std::begin(functions), std::end(functions));
+				} else {
+					post_bulk(std::make_move_iterator(std::begin(functions)), std::make_move_iterator(std::end(functions)));
+				}
+			}
 
+			template<typename iterator_type>
+			std::future<void> exec_bulk(iterator_type first, iterator_type last) {
+				auto group = std::allocate_shared<task_group>(pooled_allocator<task_group>());
+				auto future = group->get_future();
+				auto tasks = make_grouped_tasks(first, last, group);
+				group->expect(tasks.size());
+				schedule_bulk(std::move(tasks));
 				return future;
 			}
+
+			template<typename range_type>
+			std::future<void> exec_bulk(range_type&& functions) {
+				if constexpr (std::is_lvalue_reference<range_type>::value) {
+					return exec_bulk(std::begin(functions), std::end(functions));
+				} else {
+					return exec_bulk(std::make_move_iterator(std::begin(functions)), std::make_move_iterator(std::end(functions)));
+				}
+			}
+
+			template<typename iterator_type>
+			std::future<void> exec_bulk(const cancellation_token& token, iterator_type first, iterator_type last) {
+				auto group = std::allocate_shared<task_group>(pooled_allocator<task_group>());
+				auto future = group->get_future();
+				auto tasks = make_grouped_tasks(first, last, group, token);
+				group->expect(tasks.size());
+				schedule_bulk(std::move(tasks));
+				return future;
+			}
+
+			template<typename range_type>
+			std::future<void> exec_bulk(const cancellation_token& token, range_type&& functions) {
+				if constexpr (std::is_lvalue_reference<range_type>::value) {
+					return exec_bulk(token, std::begin(functions), std::end(functions));
+				} else {
+					return exec_bulk(token, std::make_move_iterator(std::begin(functions)), std::make_move_iterator(std::end(functions)));
+				}
+			}
+
+			template<typename clock_type, typename duration_type, typename function_type, typename... args_types>
+			timer_handle exec_at(const std::chrono::time_point<clock_type, duration_type>& deadline, function_type&& function, args_types&&... args) {
+				std::chrono::steady_clock::time_point steady_deadline;
+				if constexpr (std::is_same<clock_type, std::chrono::steady_clock>::value) {
+					steady_deadline = std::chrono::time_point_cast<std::chrono::steady_clock::duration>(deadline);
+				} else {
+					steady_deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline - clock_type::now());
+				}
+				return get_timers().schedule(steady_deadline, std::chrono::steady_clock::duration::zero(), make_timer_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<typename rep_type, typename period_type, typename function_type, typename... args_types>
+			timer_handle exec_after(const std::chrono::duration<rep_type, period_type>& delay, function_type&& function, args_types&&... args) {
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+				return get_timers().schedule(deadline, std::chrono::steady_clock::duration::zero(), make_timer_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
+
+			template<typename rep_type, typename period_type, typename function_type, typename... args_types>
+			timer_handle exec_every(const std::chrono::duration<rep_type, period_type>& period, function_type&& function, args_types&&... args) {
+				auto steady_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+				return get_timers().schedule(std::chrono::steady_clock::now() + steady_period, steady_period, make_timer_task(std::forward<function_type>(function), std::forward<args_types>(args)...));
+			}
 	};
 }
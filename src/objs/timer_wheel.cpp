@@ -0,0 +1,286 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "pooled_allocator.h"
+
+using namespace std;
+using namespace parallel_tools;
+
+timer_wheel::timer_wheel(function<void(vector<task>&&)> dispatch, chrono::steady_clock::duration tick) :
+	tick(max(tick, chrono::steady_clock::duration(1))),
+	start(chrono::steady_clock::now()),
+	dispatch(std::move(dispatch)),
+	stopping(false),
+	purge_requested(false),
+	wake_up_tick(numeric_limits<uint64_t>::max()),
+	number_of_timers(0),
+	cancellations(make_shared<timer_cancellations>()),
+	current_tick(0)
+{
+	cancellations->pending = 0;
+	cancellations->wheel = this;
+	timer_thread = thread([this] {
+		run();
+	});
+}
+
+timer_wheel::~timer_wheel() {
+	stop();
+}
+
+void timer_control::cancel() {
+	if (cancelled.exchange(true)) {
+		return;
+	}
+	cancellations->pending.fetch_add(1, memory_order_relaxed);
+	auto state = wheel_state.load(memory_order_relaxed);
+	while (state & in_wheel) {
+		if (wheel_state.compare_exchange_weak(state, state | counted, memory_order_relaxed)) {
+			lock_guard lock(cancellations->mutex);
+			if (cancellations->wheel) {
+				cancellations->wheel->request_purge();
+			}
+			return;
+		}
+	}
+	cancellations->pending.fetch_sub(1, memory_order_relaxed);
+}
+
+void timer_wheel::stop() {
+	{
+		lock_guard lock(cancellations->mutex);
+		cancellations->wheel = nullptr;
+	}
+	{
+		lock_guard lock(mutex);
+		stopping = true;
+	}
+	wake_up.notify_all();
+	if (timer_thread.joinable()) {
+		timer_thread.join();
+	}
+}
+
+uint64_t timer_wheel::to_tick(chrono::steady_clock::time_point time_point, bool round_up) const {
+	if (time_point <= start) {
+		return 0;
+	}
+	auto elapsed = time_point - start;
+	uint64_t ticks = elapsed/tick;
+	if (round_up && elapsed%tick != chrono::steady_clock::duration::zero()) {
+		ticks++;
+	}
+	return ticks;
+}
+
+timer_handle timer_wheel::schedule(chrono::steady_clock::time_point deadline, chrono::steady_clock::duration period, task&& callback) {
+	uint64_t period_ticks = 0;
+	if (period > chrono::steady_clock::duration::zero()) {
+		period_ticks = max<uint64_t>(1, to_tick(start + period, true));
+	}
+	auto control = allocate_shared<timer_control>(pooled_allocator<timer_control>(), std::move(callback), period_ticks, cancellations);
+	timer_entry entry = {to_tick(deadline, true), control};
+
+	bool wake_timer_thread;
+	{
+		lock_guard lock(mutex);
+		incoming.push_back(std::move(entry));
+		wake_timer_thread = entry.expiry < wake_up_tick;
+	}
+	if (wake_timer_thread) {
+		wake_up.notify_one();
+	}
+	return timer_handle(std::move(control));
+}
+
+void timer_wheel::insert(timer_entry&& entry, vector<task>& expired) {
+	if (entry.control->cancelled) {
+		return;
+	}
+	if (entry.expiry <= current_tick) {
+		expire(std::move(entry), expired);
+		return;
+	}
+
+	auto delta = entry.expiry - current_tick;
+	for (unsigned level = 0; level < levels; level++) {
+		if (delta < (slots_per_level << (level*slot_bits))) {
+			auto slot = (entry.expiry >> (level*slot_bits)) & (slots_per_level - 1);
+			entry.control->enter_wheel();
+			slots[level][slot].push_back(std::move(entry));
+			number_of_timers++;
+			return;
+		}
+	}
+	entry.control->enter_wheel();
+	overflow.push_back(std::move(entry));
+	number_of_timers++;
+}
+
+void timer_wheel::cascade(vector<timer_entry>& slot, vector<task>& expired) {
+	auto cascaded_entries = std::move(slot);
+	slot.clear();
+	number_of_timers -= cascaded_entries.size();
+	for (auto& entry : cascaded_entries) {
+		entry.control->leave_wheel();
+		insert(std::move(entry), expired);
+	}
+}
+
+void timer_wheel::expire(timer_entry&& entry, vector<task>& expired) {
+	auto& control = entry.control;
+	if (control->cancelled) {
+		return;
+	}
+
+	if (!control->running.exchange(true)) {
+		expired.emplace_back([control = control] {
+			if (!control->cancelled) {
+				try {
+					control->callback();
+				} catch (...) {
+					control->running = false;
+					throw;
+				}
+			}
+			control->running = false;
+		});
+	}
+
+	if (control->period_ticks > 0) {
+		entry.expiry = max(entry.expiry + control->period_ticks, current_tick + 1);
+		insert(std::move(entry), expired);
+	}
+}
+
+void timer_wheel::advance(uint64_t target_tick, vector<task>& expired) {
+	while (current_tick < target_tick) {
+		current_tick++;
+		auto level_ticks = current_tick;
+		unsigned cascaded_levels = 0;
+		while (cascaded_levels < levels - 1 && (level_ticks & (slots_per_level - 1)) == 0) {
+			level_ticks >>= slot_bits;
+			cascaded_levels++;
+		}
+		if (cascaded_levels == levels - 1 && (level_ticks & (slots_per_level - 1)) == 0) {
+			cascade(overflow, expired);
+		}
+		for (auto level = cascaded_levels; level > 0; level--) {
+			auto slot = (current_tick >> (level*slot_bits)) & (slots_per_level - 1);
+			cascade(slots[level][slot], expired);
+		}
+
+		auto& due_timers = slots[0][current_tick & (slots_per_level - 1)];
+		number_of_timers -= due_timers.size();
+		auto due_entries = std::move(due_timers);
+		due_timers.clear();
+		for (auto& entry : due_entries) {
+			entry.control->leave_wheel();
+			expire(std::move(entry), expired);
+		}
+	}
+}
+
+void timer_wheel::remove_cancelled(vector<timer_entry>& slot) {
+	auto first_removed = remove_if(slot.begin(), slot.end(), [](const timer_entry& entry) {
+		if (!entry.control->cancelled) {
+			return false;
+		}
+		entry.control->leave_wheel();
+		return true;
+	});
+	number_of_timers -= size_t(slot.end() - first_removed);
+	slot.erase(first_removed, slot.end());
+}
+
+bool timer_wheel::should_purge() const {
+	auto cancelled_timers = cancellations->pending.load(memory_order_relaxed);
+	return cancelled_timers > 0 && cancelled_timers*2 >= number_of_timers;
+}
+
+void timer_wheel::request_purge() {
+	if (!should_purge()) {
+		return;
+	}
+	{
+		lock_guard lock(mutex);
+		purge_requested = true;
+	}
+	wake_up.notify_one();
+}
+
+void timer_wheel::purge_cancelled() {
+	if (!should_purge()) {
+		return;
+	}
+	for (auto& level : slots) {
+		for (auto& slot : level) {
+			remove_cancelled(slot);
+		}
+	}
+	remove_cancelled(overflow);
+}
+
+uint64_t timer_wheel::next_tick() const {
+	auto next = numeric_limits<uint64_t>::max();
+	if (!overflow.empty()) {
+		next = ((current_tick >> (levels*slot_bits)) + 1) << (levels*slot_bits);
+	}
+	for (unsigned level = 0; level < levels; level++) {
+		auto shift = level*slot_bits;
+		auto rotation = uint64_t(1) << (shift + slot_bits);
+		auto rotation_start = current_tick & ~(rotation - 1);
+		for (uint64_t slot = 0; slot < slots_per_level; slot++) {
+			if (slots[level][slot].empty()) {
+				continue;
+			}
+			auto slot_start = rotation_start + (slot << shift);
+			if (slot_start <= current_tick) {
+				slot_start += rotation;
+			}
+			next = min(next, slot_start);
+		}
+	}
+	return next;
+}
+
+void timer_wheel::run() {
+	vector<timer_entry> arrived;
+	unique_lock lock(mutex);
+	while (!stopping) {
+		if (incoming.empty()) {
+			wake_up_tick = number_of_timers == 0 ? numeric_limits<uint64_t>::max() : next_tick();
+			if (wake_up_tick == numeric_limits<uint64_t>::max()) {
+				wake_up.wait(lock, [this] {
+					return stopping || purge_requested || !incoming.empty();
+				});
+			} else {
+				wake_up.wait_until(lock, start + wake_up_tick*tick, [this] {
+					return stopping || purge_requested || !incoming.empty();
+				});
+			}
+			wake_up_tick = 0;
+			if (stopping) {
+				break;
+			}
+		}
+		arrived.swap(incoming);
+		purge_requested = false;
+		lock.unlock();
+
+		vector<task> expired;
+		for (auto& entry : arrived) {
+			insert(std::move(entry), expired);
+		}
+		arrived.clear();
+		advance(to_tick(chrono::steady_clock::now(), false), expired);
+		purge_cancelled();
+		if (!expired.empty()) {
+			dispatch(std::move(expired));
+		}
+
+		lock.lock();
+	}
+}
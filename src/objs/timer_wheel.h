@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "task.h"
+
+namespace parallel_tools {
+	class timer_wheel;
+
+	struct timer_cancellations {
+		std::atomic<size_t> pending;
+		std::mutex mutex;
+		timer_wheel* wheel;
+	};
+
+	struct timer_control {
+		static constexpr uint8_t in_wheel = 1;
+		static constexpr uint8_t counted = 2;
+
+		task callback;
+		uint64_t period_ticks;
+		std::atomic<bool> cancelled;
+		std::atomic<bool> running;
+		std::atomic<uint8_t> wheel_state;
+		const std::shared_ptr<timer_cancellations> cancellations;
+
+		timer_control(task&& callback, uint64_t period_ticks, std::shared_ptr<timer_cancellations> cancellations) :
+			callback(std::move(callback)),
+			period_ticks(period_ticks),
+			cancelled(false),
+			running(false),
+			wheel_state(0),
+			cancellations(std::move(cancellations))
+		{}
+
+		void cancel();
+
+		void enter_wheel() {
+			wheel_state.store(in_wheel, std::memory_order_relaxed);
+		}
+
+		void leave_wheel() {
+			if (wheel_state.exchange(0, std::memory_order_relaxed) & counted) {
+				cancellations->pending.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	class timer_handle {
+		private:
+			std::shared_ptr<timer_control> control;
+
+		public:
+			timer_handle() = default;
+
+			explicit timer_handle(std::shared_ptr<timer_control> control) :
+				control(std::move(control))
+			{}
+
+			void cancel() {
+				if (control) {
+					control->cancel();
+				}
+			}
+
+			bool is_cancelled() const {
+				return control && control->cancelled;
+			}
+	};
+
+	class timer_wheel {
+		private:
+			static constexpr unsigned slot_bits = 6;
+			static constexpr uint64_t slots_per_level = 1 << slot_bits;
+			static constexpr unsigned levels = 4;
+
+			struct timer_entry {
+				uint64_t expiry;
+				std::shared_ptr<timer_control> control;
+			};
+
+			const std::chrono::steady_clock::duration tick;
+			const std::chrono::steady_clock::time_point start;
+			const std::function<void(std::vector<task>&&)> dispatch;
+
+			std::mutex mutex;
+			std::condition_variable wake_up;
+			std::vector<timer_entry> incoming;
+			bool stopping;
+			bool purge_requested;
+			uint64_t wake_up_tick;
+
+			std::vector<timer_entry> slots[levels][slots_per_level];
+			std::vector<timer_entry> overflow;
+			std::atomic<size_t> number_of_timers;
+			const std::shared_ptr<timer_cancellations> cancellations;
+			uint64_t current_tick;
+			std::thread timer_thread;
+
+			uint64_t to_tick(std::chrono::steady_clock::time_point time_point, bool round_up) const;
+			void insert(timer_entry&& entry, std::vector<task>& expired);
+			void cascade(std::vector<timer_entry>& slot, std::vector<task>& expired);
+			void expire(timer_entry&& entry, std::vector<task>& expired);
+			void advance(uint64_t target_tick, std::vector<task>& expired);
+			void remove_cancelled(std::vector<timer_entry>& slot);
+			bool should_purge() const;
+			void purge_cancelled();
+			void request_purge();
+			uint64_t next_tick() const;
+			void run();
+
+			friend struct timer_control;
+
+		public:
+			timer_wheel(std::function<void(std::vector<task>&&)> dispatch, std::chrono::steady_clock::duration tick = std::chrono::milliseconds(1));
+			~timer_wheel();
+
+			timer_wheel(const timer_wheel&) = delete;
+			timer_wheel& operator=(const timer_wheel&) = delete;
+
+			timer_handle schedule(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration period, task&& callback);
+			void stop();
+
+			size_t get_number_of_timers() const {
+				return number_of_timers;
+			}
+	};
+}
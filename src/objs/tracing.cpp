@@ -0,0 +1,167 @@
+#include "tracing.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+using namespace std;
+using namespace parallel_tools;
+
+namespace {
+	void write_json_string(ostream& output, const string& text) {
+		output << '"';
+		for (auto character : text) {
+			if (character == '"' || character == '\\') {
+				output << '\\' << character;
+			} else if (static_cast<unsigned char>(character) < 0x20) {
+				output << "\\u" << hex << setw(4) << setfill('0') << int(character) << dec << setfill(' ');
+			} else {
+				output << character;
+			}
+		}
+		output << '"';
+	}
+
+	void write_microseconds(ostream& output, double nanoseconds) {
+		output << fixed << setprecision(3) << nanoseconds/1000.0;
+	}
+
+	void write_complete_event(ostream& output, const char* name, const char* category, size_t thread, double begin, double end, double origin) {
+		output << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":";
+		write_microseconds(output, begin - origin);
+		output << ",\"dur\":";
+		write_microseconds(output, end - begin);
+	}
+}
+
+trace_buffer::trace_buffer() :
+	slots(new slot[capacity]),
+	claimed_events(0),
+	written_events(0),
+	retired(false)
+{}
+
+vector<trace_event> trace_buffer::read() const {
+	auto last = written_events.load(memory_order_acquire);
+	auto first = last > capacity ? last - capacity : 0;
+
+	vector<trace_event> events;
+	events.reserve(last - first);
+	for (auto index = first; index < last; index++) {
+		auto& event = slots[index%capacity];
+		events.push_back({
+			event.type.load(memory_order_relaxed),
+			event.begin.load(memory_order_relaxed),
+			event.end.load(memory_order_relaxed),
+			event.argument.load(memory_order_relaxed)
+		});
+	}
+
+	atomic_thread_fence(memory_order_acquire);
+	auto claimed = claimed_events.load(memory_order_relaxed);
+	if (claimed > first + capacity) {
+		auto overwritten_events = min<uint64_t>(claimed - capacity - first, events.size());
+		events.erase(events.begin(), events.begin() + overwritten_events);
+	}
+	return events;
+}
+
+trace_recorder<true>::trace_recorder() :
+	archived_events(0),
+	calibration_time(chrono::steady_clock::now()),
+	calibration_ticks(trace_clock())
+{}
+
+trace_buffer* trace_recorder<true>::register_worker(const string& name, size_t index) {
+	lock_guard lock(buffers_mutex);
+	auto retired_buffer = find_if(buffers.begin(), buffers.end(), [](const trace_buffer& buffer) {
+		return buffer.retired.load();
+	});
+	auto buffer = retired_buffer != buffers.end() ? &*retired_buffer : &buffers.emplace_back();
+	if (retired_buffer != buffers.end()) {
+		archived_traces.push_back({buffer->name, buffer->read()});
+		archived_events += archived_traces.back().events.size();
+		while (archived_events > trace_buffer::capacity) {
+			archived_events -= archived_traces.front().events.size();
+			archived_traces.pop_front();
+		}
+		buffer->clear();
+	}
+	buffer->name = (name.empty() ? "worker" : name) + "-" + to_string(index);
+	buffer->retired = false;
+	return buffer;
+}
+
+void trace_recorder<true>::retire_worker(trace_buffer* buffer) {
+	buffer->retired = true;
+}
+
+void trace_recorder<true>::write_chrome_trace(ostream& output) {
+	vector<string> names;
+	vector<vector<trace_event>> events;
+	{
+		lock_guard lock(buffers_mutex);
+		for (auto& archived_trace : archived_traces) {
+			names.push_back(archived_trace.name);
+			events.push_back(archived_trace.events);
+		}
+		for (auto& buffer : buffers) {
+			names.push_back(buffer.name);
+			events.push_back(buffer.read());
+		}
+	}
+
+	auto elapsed_ticks = trace_clock() - calibration_ticks;
+	auto elapsed_nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - calibration_time).count();
+	auto nanoseconds_per_tick = elapsed_ticks > 0 ? double(elapsed_nanoseconds)/elapsed_ticks : 1.0;
+	auto to_nanoseconds = [&](int64_t ticks) {
+		return (ticks - calibration_ticks)*nanoseconds_per_tick;
+	};
+
+	auto origin = numeric_limits<double>::max();
+	for (auto& thread_events : events) {
+		for (auto& event : thread_events) {
+			origin = min({origin, to_nanoseconds(event.begin), to_nanoseconds(event.type == trace_event_type::task ? event.argument : event.begin)});
+		}
+	}
+
+	auto flags = output.flags();
+	auto precision = output.precision();
+	output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	output << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"thread_pool\"}}";
+	for (size_t thread = 0; thread < events.size(); thread++) {
+		output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":";
+		write_json_string(output, names[thread]);
+		output << "}}";
+
+		auto& thread_events = events[thread];
+		sort(thread_events.begin(), thread_events.end(), [](const trace_event& a, const trace_event& b) {
+			return a.begin < b.begin;
+		});
+		auto busy_until = numeric_limits<int64_t>::min();
+		for (auto& event : thread_events) {
+			auto begin = to_nanoseconds(event.begin);
+			auto end = to_nanoseconds(event.end);
+			if (event.type == trace_event_type::swap) {
+				write_complete_event(output, "swap", "production_queue", thread, begin, end, origin);
+				output << ",\"args\":{\"resources\":" << event.argument << "}}";
+				continue;
+			}
+			if (busy_until != numeric_limits<int64_t>::min() && event.begin > busy_until) {
+				write_complete_event(output, "idle", "thread_pool", thread, to_nanoseconds(busy_until), begin, origin);
+				output << "}";
+			}
+			busy_until = max(busy_until, event.end);
+			auto submitted = to_nanoseconds(event.argument);
+			write_complete_event(output, "task", "thread_pool", thread, begin, end, origin);
+			output << ",\"args\":{\"submitted_us\":";
+			write_microseconds(output, submitted - origin);
+			output << ",\"queued_us\":";
+			write_microseconds(output, begin - submitted);
+			output << "}}";
+		}
+	}
+	output << "\n]}\n";
+	output.flags(flags);
+	output.precision(precision);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#include <x86intrin.h>
+	#define PARALLEL_TOOLS_TRACE_WITH_TSC
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+	#include <intrin.h>
+	#define PARALLEL_TOOLS_TRACE_WITH_TSC
+#endif
+
+namespace parallel_tools {
+#if defined(PARALLEL_TOOLS_TRACING)
+	constexpr bool tracing_enabled = true;
+#else
+	constexpr bool tracing_enabled = false;
+#endif
+
+	inline int64_t trace_clock() {
+#if defined(PARALLEL_TOOLS_TRACE_WITH_TSC)
+		return int64_t(__rdtsc());
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	enum class trace_event_type : uint8_t {
+		task,
+		swap
+	};
+
+	struct trace_event {
+		trace_event_type type;
+		int64_t begin;
+		int64_t end;
+		int64_t argument;
+	};
+
+	class trace_buffer {
+		private:
+			struct slot {
+				std::atomic<trace_event_type> type;
+				std::atomic<int64_t> begin;
+				std::atomic<int64_t> end;
+				std::atomic<int64_t> argument;
+			};
+
+			std::unique_ptr<slot[]> slots;
+			std::atomic<uint64_t> claimed_events;
+			std::atomic<uint64_t> written_events;
+
+		public:
+			static constexpr size_t capacity = 1 << 15;
+
+			std::string name;
+			std::atomic<bool> retired;
+
+			trace_buffer();
+
+			void record(trace_event_type type, int64_t begin, int64_t end, int64_t argument) {
+				auto index = written_events.load(std::memory_order_relaxed);
+				claimed_events.store(index + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				auto& event = slots[index%capacity];
+				event.type.store(type, std::memory_order_relaxed);
+				event.begin.store(begin, std::memory_order_relaxed);
+				event.end.store(end, std::memory_order_relaxed);
+				event.argument.store(argument, std::memory_order_relaxed);
+				written_events.store(index + 1, std::memory_order_release);
+			}
+
+			std::vector<trace_event> read() const;
+
+			void clear() {
+				claimed_events.store(0, std::memory_order_relaxed);
+				written_events.store(0, std::memory_order_release);
+			}
+	};
+
+	inline trace_buffer*& current_trace_buffer() {
+		thread_local trace_buffer* buffer = nullptr;
+		return buffer;
+	}
+
+	inline int64_t begin_traced_event() {
+		if constexpr (tracing_enabled) {
+			return current_trace_buffer() ? trace_clock() : 0;
+		} else {
+			return 0;
+		}
+	}
+
+	inline void end_traced_event(trace_event_type type, int64_t begin, int64_t argument) {
+		if constexpr (tracing_enabled) {
+			if (begin != 0) {
+				current_trace_buffer()->record(type, begin, trace_clock(), argument);
+			}
+		}
+	}
+
+	template<bool enabled = tracing_enabled>
+	class trace_recorder;
+
+	template<>
+	class trace_recorder<true> {
+		private:
+			struct archived_trace {
+				std::string name;
+				std::vector<trace_event> events;
+			};
+
+			std::mutex buffers_mutex;
+			std::deque<trace_buffer> buffers;
+			std::deque<archived_trace> archived_traces;
+			size_t archived_events;
+			const std::chrono::steady_clock::time_point calibration_time;
+			const int64_t calibration_ticks;
+
+		public:
+			trace_recorder();
+
+			trace_buffer* register_worker(const std::string& name, size_t index);
+			void retire_worker(trace_buffer* buffer);
+			void write_chrome_trace(std::ostream& output);
+	};
+
+	template<>
+	class trace_recorder<false> {
+		public:
+			trace_buffer* register_worker(const std::string&, size_t) {
+				return nullptr;
+			}
+
+			void retire_worker(trace_buffer*) {}
+
+			void write_chrome_trace(std::ostream& output) {
+				output << "{\"traceEvents\":[]}\n";
+			}
+	};
+}
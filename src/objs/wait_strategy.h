@@ -0,0 +1,375 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "hardware.h"
+
+#ifdef __linux__
+	#include <climits>
+	#include <ctime>
+	#include <linux/futex.h>
+	#include <linux/membarrier.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace parallel_tools {
+	inline bool asymmetric_barriers_available() {
+	#ifdef __linux__
+		static const bool available = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+		return available;
+	#else
+		return false;
+	#endif
+	}
+
+	inline void light_barrier() {
+		if (asymmetric_barriers_available()) {
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		} else {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	inline void heavy_barrier() {
+	#ifdef __linux__
+		if (asymmetric_barriers_available()) {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+			return;
+		}
+	#endif
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	namespace wait_strategy {
+		class busy_spin {
+			public:
+				static constexpr unsigned spin_attempts = std::numeric_limits<unsigned>::max();
+
+				void spin(unsigned) {
+					cpu_relax();
+				}
+
+				void block(const std::atomic<uint32_t>& epoch, uint32_t key) {
+					while (epoch.load(std::memory_order_acquire) == key) {
+						cpu_relax();
+					}
+				}
+
+				template<typename clock_type, typename duration_type>
+				bool block_until(const std::atomic<uint32_t>& epoch, uint32_t key, const std::chrono::time_point<clock_type, duration_type>& deadline) {
+					while (epoch.load(std::memory_order_acquire) == key) {
+						if (clock_type::now() >= deadline) {
+							return false;
+						}
+						cpu_relax();
+					}
+					return true;
+				}
+
+				void wake(std::atomic<uint32_t>&, bool) {}
+		};
+
+		class spin_then_yield {
+			private:
+				static constexpr unsigned spins_before_yielding = 64;
+
+			public:
+				static constexpr unsigned spin_attempts = std::numeric_limits<unsigned>::max();
+
+				void spin(unsigned attempt) {
+					if (attempt < spins_before_yielding) {
+						cpu_relax();
+					} else {
+						std::this_thread::yield();
+					}
+				}
+
+				void block(const std::atomic<uint32_t>& epoch, uint32_t key) {
+					while (epoch.load(std::memory_order_acquire) == key) {
+						std::this_thread::yield();
+					}
+				}
+
+				template<typename clock_type, typename duration_type>
+				bool block_until(const std::atomic<uint32_t>& epoch, uint32_t key, const std::chrono::time_point<clock_type, duration_type>& deadline) {
+					while (epoch.load(std::memory_order_acquire) == key) {
+						if (clock_type::now() >= deadline) {
+							return false;
+						}
+						std::this_thread::yield();
+					}
+					return true;
+				}
+
+				void wake(std::atomic<uint32_t>&, bool) {}
+		};
+
+		class blocking {
+			private:
+				std::mutex mutex;
+				std::condition_variable notifier;
+
+			public:
+				static constexpr unsigned spin_attempts = 0;
+
+				void spin(unsigned) {}
+
+				void block(const std::atomic<uint32_t>& epoch, uint32_t key) {
+					std::unique_lock lock(mutex);
+					notifier.wait(lock, [&] {
+						return epoch.load(std::memory_order_acquire) != key;
+					});
+				}
+
+				template<typename clock_type, typename duration_type>
+				bool block_until(const std::atomic<uint32_t>& epoch, uint32_t key, const std::chrono::time_point<clock_type, duration_type>& deadline) {
+					std::unique_lock lock(mutex);
+					return notifier.wait_until(lock, deadline, [&] {
+						return epoch.load(std::memory_order_acquire) != key;
+					});
+				}
+
+				void wake(std::atomic<uint32_t>&, bool all) {
+					std::lock_guard lock(mutex);
+					if (all) {
+						notifier.notify_all();
+					} else {
+						notifier.notify_one();
+					}
+				}
+		};
+
+		class spin_then_park {
+			private:
+				static constexpr unsigned spins_before_yielding = 64;
+
+				std::atomic<uint32_t> parked_threads;
+			#ifdef __linux__
+				static long futex(const std::atomic<uint32_t>& epoch, int operation, uint32_t value, const timespec* timeout) {
+					auto address = const_cast<uint32_t*>(reinterpret_cast<const volatile uint32_t*>(&epoch));
+					return syscall(SYS_futex, address, operation, value, timeout, nullptr, 0);
+				}
+			#else
+				blocking parking;
+			#endif
+
+			public:
+				static constexpr unsigned spin_attempts = spins_before_yielding + 64;
+
+				spin_then_park() :
+					parked_threads(0)
+				{}
+
+				void spin(unsigned attempt) {
+					if (attempt < spins_before_yielding) {
+						cpu_relax();
+					} else {
+						std::this_thread::yield();
+					}
+				}
+
+				void block(const std::atomic<uint32_t>& epoch, uint32_t key) {
+					parked_threads.fetch_add(1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				#ifdef __linux__
+					while (epoch.load(std::memory_order_acquire) == key) {
+						futex(epoch, FUTEX_WAIT_PRIVATE, key, nullptr);
+					}
+				#else
+					parking.block(epoch, key);
+				#endif
+					parked_threads.fetch_sub(1, std::memory_order_relaxed);
+				}
+
+				template<typename clock_type, typename duration_type>
+				bool block_until(const std::atomic<uint32_t>& epoch, uint32_t key, const std::chrono::time_point<clock_type, duration_type>& deadline) {
+					parked_threads.fetch_add(1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				#ifdef __linux__
+					bool woken = true;
+					while (epoch.load(std::memory_order_acquire) == key) {
+						auto remaining_time = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - clock_type::now()).count();
+						if (remaining_time <= 0) {
+							woken = false;
+							break;
+						}
+						timespec timeout;
+						timeout.tv_sec = remaining_time / 1'000'000'000;
+						timeout.tv_nsec = remaining_time % 1'000'000'000;
+						futex(epoch, FUTEX_WAIT_PRIVATE, key, &timeout);
+					}
+				#else
+					bool woken = parking.block_until(epoch, key, deadline);
+				#endif
+					parked_threads.fetch_sub(1, std::memory_order_relaxed);
+					return woken;
+				}
+
+				void wake(std::atomic<uint32_t>& epoch, bool all) {
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (parked_threads.load(std::memory_order_relaxed) == 0) {
+						return;
+					}
+				#ifdef __linux__
+					futex(epoch, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr);
+				#else
+					parking.wake(epoch, all);
+				#endif
+				}
+		};
+	}
+
+	template<typename type>
+	struct is_wait_strategy : std::false_type {};
+	template<>
+	struct is_wait_strategy<wait_strategy::busy_spin> : std::true_type {};
+	template<>
+	struct is_wait_strategy<wait_strategy::spin_then_yield> : std::true_type {};
+	template<>
+	struct is_wait_strategy<wait_strategy::spin_then_park> : std::true_type {};
+	template<>
+	struct is_wait_strategy<wait_strategy::blocking> : std::true_type {};
+
+	template<typename wait_strategy_type>
+	class thread_parker {
+		private:
+			struct no_lock {
+				void lock() {}
+				void unlock() {}
+			};
+
+			std::atomic<uint32_t> epoch;
+			std::atomic<size_t> waiting_threads;
+			wait_strategy_type strategy;
+
+			uint32_t register_waiter() {
+				waiting_threads.fetch_add(1, std::memory_order_relaxed);
+				heavy_barrier();
+				return epoch.load(std::memory_order_acquire);
+			}
+
+			void unregister_waiter() {
+				waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			void notify(bool all) {
+				light_barrier();
+				if (waiting_threads.load(std::memory_order_relaxed) > 0) {
+					epoch.fetch_add(1, std::memory_order_acq_rel);
+					strategy.wake(epoch, all);
+				}
+			}
+
+		public:
+			thread_parker() :
+				epoch(0),
+				waiting_threads(0)
+			{}
+
+			template<typename lock_type, typename hint_type>
+			void spin_unlocked(lock_type& lock, unsigned& attempt, const hint_type& may_be_satisfied) {
+				lock.unlock();
+				do {
+					strategy.spin(attempt++);
+				} while (attempt < wait_strategy_type::spin_attempts && !may_be_satisfied());
+				lock.lock();
+			}
+
+			template<typename lock_type, typename hint_type, typename predicate_type>
+			void wait(lock_type& lock, const hint_type& may_be_satisfied, const predicate_type& predicate) {
+				for (unsigned attempt = 0; !predicate();) {
+					if (attempt < wait_strategy_type::spin_attempts) {
+						spin_unlocked(lock, attempt, may_be_satisfied);
+						continue;
+					}
+
+					auto key = register_waiter();
+					bool satisfied = predicate();
+					if (!satisfied) {
+						lock.unlock();
+						strategy.block(epoch, key);
+						lock.lock();
+					}
+					unregister_waiter();
+					if (satisfied) {
+						return;
+					}
+				}
+			}
+
+			template<typename lock_type, typename predicate_type>
+			void wait(lock_type& lock, const predicate_type& predicate) {
+				wait(lock, [] { return true; }, predicate);
+			}
+
+			template<typename predicate_type>
+			void wait(const predicate_type& predicate) {
+				no_lock lock;
+				wait(lock, predicate, predicate);
+			}
+
+			template<typename lock_type, typename hint_type, typename predicate_type, typename clock_type, typename duration_type>
+			bool wait_until(lock_type& lock, const std::chrono::time_point<clock_type, duration_type>& deadline, const hint_type& may_be_satisfied, const predicate_type& predicate) {
+				for (unsigned attempt = 0; !predicate();) {
+					if (attempt < wait_strategy_type::spin_attempts) {
+						if (clock_type::now() >= deadline) {
+							return false;
+						}
+						spin_unlocked(lock, attempt, [&] {
+							return may_be_satisfied() || clock_type::now() >= deadline;
+						});
+						continue;
+					}
+
+					auto key = register_waiter();
+					bool satisfied = predicate();
+					bool woken = true;
+					if (!satisfied) {
+						lock.unlock();
+						woken = strategy.block_until(epoch, key, deadline);
+						lock.lock();
+					}
+					unregister_waiter();
+					if (satisfied) {
+						return true;
+					}
+					if (!woken) {
+						return predicate();
+					}
+				}
+				return true;
+			}
+
+			template<typename lock_type, typename predicate_type, typename clock_type, typename duration_type>
+			bool wait_until(lock_type& lock, const std::chrono::time_point<clock_type, duration_type>& deadline, const predicate_type& predicate) {
+				return wait_until(lock, deadline, [] { return true; }, predicate);
+			}
+
+			template<typename predicate_type, typename clock_type, typename duration_type>
+			bool wait_until(const std::chrono::time_point<clock_type, duration_type>& deadline, const predicate_type& predicate) {
+				no_lock lock;
+				return wait_until(lock, deadline, predicate, predicate);
+			}
+
+			void notify_one() {
+				notify(false);
+			}
+
+			void notify_all() {
+				notify(true);
+			}
+
+			size_t get_waiting_threads() const {
+				return waiting_threads.load(std::memory_order_relaxed);
+			}
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "hardware.h"
+
+namespace parallel_tools {
+	template<typename resource_type>
+	class work_stealing_deque {
+		static_assert(std::is_trivially_copyable<resource_type>::value, "work_stealing_deque requires trivially copyable resources");
+
+		private:
+			static constexpr int64_t initial_capacity = 64;
+
+			class circular_array {
+				private:
+					const int64_t mask;
+					std::unique_ptr<std::atomic<resource_type>[]> slots;
+
+				public:
+					explicit circular_array(int64_t capacity) :
+						mask(capacity - 1),
+						slots(new std::atomic<resource_type>[capacity])
+					{}
+
+					int64_t capacity() const {
+						return mask + 1;
+					}
+
+					resource_type get(int64_t index) const {
+						return slots[index & mask].load(std::memory_order_relaxed);
+					}
+
+					void put(int64_t index, resource_type resource) {
+						slots[index & mask].store(resource, std::memory_order_relaxed);
+					}
+			};
+
+			alignas(cache_line_size) std::atomic<int64_t> top;
+			alignas(cache_line_size) std::atomic<int64_t> bottom;
+			std::atomic<circular_array*> array;
+			std::vector<std::unique_ptr<circular_array>> arrays;
+
+			circular_array* grow(circular_array* current_array, int64_t current_bottom, int64_t current_top) {
+				arrays.emplace_back(new circular_array(current_array->capacity()*2));
+				auto grown_array = arrays.back().get();
+				for (auto index = current_top; index < current_bottom; index++) {
+					grown_array->put(index, current_array->get(index));
+				}
+				array.store(grown_array, std::memory_order_release);
+				return grown_array;
+			}
+
+		public:
+			work_stealing_deque() :
+				top(0),
+				bottom(0)
+			{
+				arrays.emplace_back(new circular_array(initial_capacity));
+				array.store(arrays.back().get(), std::memory_order_relaxed);
+			}
+
+			work_stealing_deque(const work_stealing_deque&) = delete;
+			work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+			void push(resource_type resource) {
+				auto current_bottom = bottom.load(std::memory_order_relaxed);
+				auto current_top = top.load(std::memory_order_acquire);
+				auto current_array = array.load(std::memory_order_relaxed);
+				if (current_bottom - current_top > current_array->capacity() - 1) {
+					current_array = grow(current_array, current_bottom, current_top);
+				}
+				current_array->put(current_bottom, resource);
+				std::atomic_thread_fence(std::memory_order_release);
+				bottom.store(current_bottom + 1, std::memory_order_relaxed);
+			}
+
+			std::optional<resource_type> take() {
+				auto current_bottom = bottom.load(std::memory_order_relaxed) - 1;
+				auto current_array = array.load(std::memory_order_relaxed);
+				bottom.store(current_bottom, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				auto current_top = top.load(std::memory_order_relaxed);
+
+				if (current_top > current_bottom) {
+					bottom.store(current_bottom + 1, std::memory_order_relaxed);
+					return std::nullopt;
+				}
+
+				auto resource = current_array->get(current_bottom);
+				if (current_top == current_bottom) {
+					bool won_race = top.compare_exchange_strong(current_top, current_top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+					bottom.store(current_bottom + 1, std::memory_order_relaxed);
+					if (!won_race) {
+						return std::nullopt;
+					}
+				}
+				return resource;
+			}
+
+			std::optional<resource_type> steal() {
+				auto current_top = top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				auto current_bottom = bottom.load(std::memory_order_acquire);
+
+				if (current_top >= current_bottom) {
+					return std::nullopt;
+				}
+
+				auto resource = array.load(std::memory_order_acquire)->get(current_top);
+				if (!top.compare_exchange_strong(current_top, current_top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					return std::nullopt;
+				}
+				return resource;
+			}
+
+			bool empty() const {
+				return size() == 0;
+			}
+
+			size_t size() const {
+				auto current_bottom = bottom.load(std::memory_order_relaxed);
+				auto current_top = top.load(std::memory_order_relaxed);
+				return current_bottom > current_top ? current_bottom - current_top : 0;
+			}
+	};
+}
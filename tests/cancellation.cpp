@@ -0,0 +1,70 @@
+#include <assertions-test/test.h>
+#include <cancellation.h>
+#include <chrono>
+#include <thread>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when using cancellation tokens") {
+		test_case("default tokens should never request a stop") {
+			cancellation_token token;
+
+			assert(token.is_cancelled(), ==, false);
+			assert(token.is_expired(), ==, false);
+			assert(token.stop_requested(), ==, false);
+		};
+
+		test_case("tokens should be cancelled by their source") {
+			cancellation_source source;
+			auto token = source.get_token();
+			auto copied_token = token;
+
+			source.cancel();
+
+			assert(source.is_cancelled(), ==, true);
+			assert(token.is_cancelled(), ==, true);
+			assert(copied_token.stop_requested(), ==, true);
+		};
+
+		test_case("tokens should expire after their deadline") {
+			auto token = cancellation_token().with_timeout(5ms);
+
+			assert(token.is_expired(), ==, false);
+			this_thread::sleep_for(10ms);
+			assert(token.is_expired(), ==, true);
+			assert(token.is_cancelled(), ==, false);
+		};
+
+		test_case("tokens should keep the earliest deadline") {
+			auto deadline = chrono::steady_clock::now() + 1s;
+			auto token = cancellation_token().with_deadline(deadline).with_deadline(deadline + 1h);
+
+			assert(token.get_deadline() == deadline, ==, true);
+		};
+
+		test_case("tokens should throw according to the reason of the stop") {
+			cancellation_source source;
+			auto expired_token = source.get_token().with_deadline(chrono::steady_clock::now() - 1ms);
+			bool threw_deadline_exceeded = false;
+			bool threw_task_cancelled = false;
+
+			try {
+				expired_token.throw_if_stop_requested();
+			} catch (const deadline_exceeded&) {
+				threw_deadline_exceeded = true;
+			}
+			source.cancel();
+			try {
+				expired_token.throw_if_stop_requested();
+			} catch (const deadline_exceeded&) {
+			} catch (const task_cancelled&) {
+				threw_task_cancelled = true;
+			}
+
+			assert(threw_deadline_exceeded, ==, true);
+			assert(threw_task_cancelled, ==, true);
+		};
+	}
+} end_tests;
@@ -0,0 +1,97 @@
+#include <assertions-test/test.h>
+#include <coroutine.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace parallel_tools;
+using namespace std;
+
+namespace {
+	coroutine::task<thread::id> resume_on_pool(thread_pool& pool) {
+		co_await coroutine::schedule(pool);
+		co_return this_thread::get_id();
+	}
+
+	coroutine::task<int> add_in_pool(thread_pool& pool, int a, int b) {
+		co_return co_await coroutine::awaitable_exec(pool, [](int a, int b) {
+			return a + b;
+		}, a, b);
+	}
+
+	coroutine::task<int> sum_of_sums(thread_pool& pool) {
+		auto first = co_await add_in_pool(pool, 1, 2);
+		auto second = co_await add_in_pool(pool, 3, 4);
+		co_return first + second;
+	}
+
+	coroutine::task<int> fail_in_pool(thread_pool& pool) {
+		co_await coroutine::schedule(pool);
+		throw runtime_error("failed");
+	}
+
+	coroutine::task<string> await_future(thread_pool& pool) {
+		auto text = co_await async(pool, [] {
+			return string("future");
+		});
+		co_return text + " result";
+	}
+
+	coroutine::task<> count_on_pool(thread_pool& pool, atomic<int>& counter) {
+		co_await coroutine::schedule(pool);
+		counter++;
+	}
+}
+
+begin_tests {
+	test_suite("when awaiting the pool's scheduler") {
+		test_case("the coroutine should be resumed on a worker thread") {
+			thread_pool pool(2);
+
+			auto worker_id = coroutine::sync_wait(resume_on_pool(pool));
+
+			assert(worker_id != this_thread::get_id(), ==, true);
+		};
+
+		test_case("void coroutines should complete") {
+			thread_pool pool(2);
+			atomic<int> counter(0);
+
+			coroutine::sync_wait(count_on_pool(pool, counter));
+
+			assert(counter, ==, 1);
+		};
+	}
+
+	test_suite("when awaiting tasks") {
+		test_case("awaiting a task should return its result") {
+			thread_pool pool(2);
+
+			auto sum = coroutine::sync_wait(sum_of_sums(pool));
+
+			assert(sum, ==, 10);
+		};
+
+		test_case("exceptions should propagate to the awaiter") {
+			thread_pool pool(2);
+			bool exception_propagated = false;
+
+			try {
+				coroutine::sync_wait(fail_in_pool(pool));
+			} catch (const runtime_error&) {
+				exception_propagated = true;
+			}
+
+			assert(exception_propagated, ==, true);
+		};
+
+		test_case("task futures should be awaitable") {
+			thread_pool pool(1);
+
+			auto text = coroutine::sync_wait(await_future(pool));
+
+			assert(text, ==, "future result");
+		};
+	}
+} end_tests;
@@ -0,0 +1,209 @@
+#include <assertions-test/test.h>
+#include <cpu_topology.h>
+#include <thread_pool.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+using namespace parallel_tools;
+using namespace std;
+
+namespace {
+	void write_file(const filesystem::path& path, const string& content) {
+		filesystem::create_directories(path.parent_path());
+		ofstream(path) << content << endl;
+	}
+
+	class two_packages_topology {
+		private:
+			filesystem::path root;
+
+		public:
+			two_packages_topology();
+
+			~two_packages_topology() {
+				filesystem::remove_all(root);
+			}
+
+			string path() const {
+				return root.string();
+			}
+	};
+
+	filesystem::path unique_temporary_directory() {
+		static atomic<unsigned> created_directories(0);
+		static const auto process_tag = to_string(random_device()());
+		return filesystem::temp_directory_path()/("parallel_tools_cpu_topology_" + process_tag + "_" + to_string(created_directories++));
+	}
+
+	two_packages_topology::two_packages_topology() :
+		root(unique_temporary_directory())
+	{
+		write_file(root/"online", "0-7");
+		for (unsigned id = 0; id < 8; id++) {
+			unsigned core = id%2;
+			unsigned package = (id/2)%2;
+			auto cpu_directory = root/("cpu" + to_string(id));
+			auto first_sibling = package*2 + core;
+			write_file(cpu_directory/"topology"/"core_id", to_string(core));
+			write_file(cpu_directory/"topology"/"physical_package_id", to_string(package));
+			write_file(cpu_directory/"topology"/"thread_siblings_list", to_string(first_sibling) + "," + to_string(first_sibling + 4));
+			write_file(cpu_directory/"cache"/"index0"/"level", "1");
+			write_file(cpu_directory/"cache"/"index0"/"shared_cpu_list", to_string(first_sibling) + "," + to_string(first_sibling + 4));
+			write_file(cpu_directory/"cache"/"index1"/"level", "3");
+			write_file(cpu_directory/"cache"/"index1"/"shared_cpu_list", package == 0 ? "0-1,4-5" : "2-3,6-7");
+		}
+	}
+}
+
+begin_tests {
+	test_suite("when reading the cpu topology") {
+		test_case("cpu lists should be parsed into every listed cpu") {
+			auto cpus = cpu_topology::parse_cpu_list("0-2,5,7-8");
+
+			assert(cpus == vector<unsigned>({0, 1, 2, 5, 7, 8}), ==, true);
+		};
+
+		test_case("cores, packages, caches and siblings should be read from sysfs") {
+			auto topology = cpu_topology::read(two_packages_topology().path());
+			auto& cpus = topology.get_cpus();
+
+			assert(cpus.size(), ==, 8u);
+			assert(cpus[6].core, ==, 0u);
+			assert(cpus[6].package, ==, 1u);
+			assert(cpus[6].last_level_cache, ==, 2u);
+			assert(cpus[6].sibling_rank, ==, 1u);
+		};
+
+		test_case("missing sysfs directories should fall back to one cpu per hardware thread") {
+			auto topology = cpu_topology::read("/nonexistent/parallel_tools/cpu");
+
+			assert(topology.get_cpus().size(), >=, 1u);
+		};
+	}
+
+	test_suite("when placing workers") {
+		test_case("spread placement should use every physical core of every package before siblings") {
+			auto topology = cpu_topology::read(two_packages_topology().path());
+
+			auto order = topology.spread_order();
+
+			assert(order == vector<unsigned>({0, 2, 1, 3, 4, 6, 5, 7}), ==, true);
+		};
+
+		test_case("compact placement should fill the cores sharing a last level cache first") {
+			auto topology = cpu_topology::read(two_packages_topology().path());
+
+			auto order = topology.compact_order();
+
+			assert(order == vector<unsigned>({0, 1, 4, 5, 2, 3, 6, 7}), ==, true);
+		};
+
+		test_case("a cpu set should be shared by every worker") {
+			auto topology = cpu_topology::read(two_packages_topology().path());
+
+			auto placements = place_workers(worker_options{thread_affinity::cpu_set{{1, 3}}}, topology);
+
+			assert(placements.size(), ==, 1u);
+			assert(placements[0] == vector<unsigned>({1, 3}), ==, true);
+		};
+	}
+
+#if defined(__linux__)
+	test_suite("when configuring the workers of a thread pool") {
+		test_case("workers should be pinned to the cpu set") {
+			thread_pool_options options;
+			options.workers = worker_options{thread_affinity::cpu_set{{0}}, "pinned"};
+			thread_pool pool(2, options);
+
+			auto cpu = pool.exec([] {
+				return sched_getcpu();
+			});
+
+			assert(cpu.get(), ==, 0);
+		};
+
+		test_case("workers should be named after the pool's name and their index") {
+			thread_pool_options options;
+			options.workers = worker_options{thread_affinity::none{}, "decoder"};
+			thread_pool pool(1, options);
+
+			auto name = pool.exec([] {
+				char name[16] = {};
+				pthread_getname_np(pthread_self(), name, sizeof(name));
+				return string(name);
+			});
+
+			assert(name.get(), ==, "decoder-0");
+		};
+
+		test_case("worker options should combine with any queue and wait strategy") {
+			vector<thread_pool_options> combinations(3);
+			combinations[0].queue = work_stealing{};
+			combinations[1].queue = queue_backend::ring_buffer{16};
+			combinations[1].wait = wait_strategy_tag<wait_strategy::spin_then_park>{};
+			combinations[2].queue = queue_backend::priority_levels{2};
+			combinations[2].wait = wait_strategy_tag<wait_strategy::spin_then_yield>{};
+			int results = 0;
+
+			for (auto& options : combinations) {
+				options.workers = worker_options{thread_affinity::compact{}, "combined"};
+				thread_pool pool(2, options);
+				results += pool.exec([] {
+					return 3;
+				}).get();
+			}
+
+			assert(results, ==, 9);
+		};
+
+		test_case("a retired worker's index should be reused before new indices") {
+			thread_pool_options options;
+			options.workers = worker_options{thread_affinity::none{}, "indexed"};
+			thread_pool pool(3, options);
+			auto current_name = [] {
+				char name[16] = {};
+				pthread_getname_np(pthread_self(), name, sizeof(name));
+				return string(name);
+			};
+
+			pool.resize(1);
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (pool.get_number_of_threads() > 1 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			pool.resize(3);
+			vector<string> names;
+			atomic<int> running_tasks(0);
+			vector<future<string>> futures;
+			for (int i = 0; i < 3; i++) {
+				futures.push_back(pool.exec([&] {
+					running_tasks++;
+					while (running_tasks < 3) {
+						this_thread::yield();
+					}
+					return current_name();
+				}));
+			}
+			for (auto& future : futures) {
+				names.push_back(future.get());
+			}
+			sort(names.begin(), names.end());
+
+			assert(names == vector<string>({"indexed-0", "indexed-1", "indexed-2"}), ==, true);
+		};
+	}
+#endif
+} end_tests;
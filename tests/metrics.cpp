@@ -0,0 +1,161 @@
+#include <assertions-test/test.h>
+#include <metrics.h>
+#include <chrono>
+#include <thread>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when recording values in latency histograms") {
+		test_case("small values should be recorded exactly") {
+			latency_histogram histogram;
+
+			for (uint64_t value = 0; value < 32; value++) {
+				histogram.record(value);
+			}
+			auto snapshot = histogram.snapshot();
+
+			assert(snapshot.count, ==, 32u);
+			assert(snapshot.sum, ==, 496u);
+			assert(snapshot.max, ==, 31u);
+			assert(snapshot.percentile(50), ==, 15u);
+			assert(snapshot.percentile(100), ==, 31u);
+		};
+
+		test_case("every value should fall into a bucket whose upper bound is at least the value") {
+			bool bounded = true;
+			uint64_t values[] = {0, 1, 15, 16, 17, 31, 32, 33, 1000, 123456789, uint64_t(1) << 40, ~uint64_t(0)};
+
+			for (auto value : values) {
+				auto bucket = latency_histogram::bucket_of(value);
+				bounded = bounded && bucket < latency_histogram::number_of_buckets && latency_histogram::bucket_upper_bound(bucket) >= value;
+				bounded = bounded && (bucket == 0 || latency_histogram::bucket_upper_bound(bucket - 1) < value);
+			}
+
+			assert(bounded, ==, true);
+		};
+
+		test_case("percentiles should be within the precision of the buckets") {
+			latency_histogram histogram;
+
+			for (uint64_t value = 1; value <= 10000; value++) {
+				histogram.record(value*1000);
+			}
+			auto snapshot = histogram.snapshot();
+			auto median = snapshot.percentile(50);
+			auto p99 = snapshot.percentile(99);
+
+			assert(median, >=, 5000000u);
+			assert(median, <=, 5000000u + 5000000u/16);
+			assert(p99, >=, 9900000u);
+			assert(p99, <=, 9900000u + 9900000u/16);
+			assert(snapshot.mean(), ==, 5000500.0);
+		};
+
+		test_case("durations should be recorded in nanoseconds") {
+			latency_histogram histogram;
+
+			histogram.record(chrono::microseconds(3));
+			histogram.record(chrono::steady_clock::duration(-1));
+
+			assert(histogram.snapshot().sum, ==, 3000u);
+			assert(histogram.snapshot().count, ==, 2u);
+		};
+	}
+
+	test_suite("when recording queue and pool metrics") {
+		test_case("queue metrics should count swaps and their sizes") {
+			queue_metrics<true> metrics;
+
+			metrics.record_swap(10);
+			metrics.record_swap(20);
+			auto snapshot = metrics.snapshot();
+
+			assert(snapshot.swaps, ==, 2u);
+			assert(snapshot.swap_sizes.sum, ==, 30u);
+			assert(snapshot.swap_sizes.count, ==, 2u);
+		};
+
+		test_case("queue metrics should time one in every sampling period operations") {
+			queue_metrics<true> metrics;
+
+			for (uint32_t i = 0; i < 10*queue_metrics<true>::sampling_period; i++) {
+				auto locked = metrics.record_consumer_wait(metrics.start());
+				metrics.record_lock_hold(locked);
+			}
+			auto snapshot = metrics.snapshot();
+
+			assert(snapshot.consumer_wait.count, ==, 10u);
+			assert(snapshot.lock_hold.count, ==, 10u);
+		};
+
+		test_case("pool metrics should track the busy time of workers") {
+			pool_metrics<true> metrics;
+			auto counters = metrics.register_worker(0);
+
+			auto enqueued = chrono::steady_clock::now();
+			this_thread::sleep_for(2ms);
+			auto started = chrono::steady_clock::now();
+			this_thread::sleep_for(5ms);
+			metrics.record_task(counters, enqueued, started, chrono::steady_clock::now());
+			this_thread::sleep_for(5ms);
+			metrics.retire_worker(counters);
+			auto snapshot = metrics.snapshot();
+
+			assert(snapshot.queueing_delay.count, ==, 1u);
+			assert(snapshot.queueing_delay.sum, >=, 2000000u);
+			assert(snapshot.run_time.sum, >=, 5000000u);
+			assert(snapshot.workers.size(), ==, 1u);
+			assert(snapshot.workers[0].executed_tasks, ==, 1u);
+			assert(snapshot.workers[0].retired, ==, true);
+			assert(snapshot.workers[0].busy_ratio(), >, 0.0);
+			assert(snapshot.workers[0].busy_ratio(), <, 1.0);
+		};
+
+		test_case("retired workers should leave their counters to new workers") {
+			pool_metrics<true> metrics;
+
+			metrics.retire_worker(metrics.register_worker(0));
+			metrics.register_worker(1);
+			auto snapshot = metrics.snapshot();
+
+			assert(snapshot.workers.size(), ==, 1u);
+			assert(snapshot.workers[0].index, ==, 1u);
+			assert(snapshot.workers[0].retired, ==, false);
+		};
+
+		test_case("reused counters should keep the retired worker's samples out of the new worker's histograms") {
+			pool_metrics<true> metrics;
+			auto now = chrono::steady_clock::now();
+
+			auto retired_counters = metrics.register_worker(0);
+			metrics.record_task(retired_counters, now - 3ms, now - 2ms, now);
+			metrics.retire_worker(retired_counters);
+			auto counters = metrics.register_worker(1);
+			metrics.record_task(counters, now - 1ms, now, now + 1ms);
+			auto snapshot = metrics.snapshot();
+
+			assert(counters, ==, retired_counters);
+			assert(counters->run_time.snapshot().count, ==, 1u);
+			assert(counters->run_time.snapshot().max, <, 2000000u);
+			assert(snapshot.run_time.count, ==, 2u);
+			assert(snapshot.run_time.max, >=, 2000000u);
+			assert(snapshot.queueing_delay.count, ==, 2u);
+			assert(snapshot.workers[0].executed_tasks, ==, 1u);
+		};
+
+		test_case("disabled metrics should record nothing") {
+			pool_metrics<false> metrics;
+			auto counters = metrics.register_worker(0);
+
+			auto now = chrono::steady_clock::now();
+			metrics.record_task(counters, now, now, now);
+
+			assert(metrics.snapshot().run_time.count, ==, 0u);
+			assert(metrics.snapshot().workers.empty(), ==, true);
+			assert(sizeof(pool_metrics<false>), ==, 1u);
+			assert(sizeof(queue_metrics<false>), ==, 1u);
+		};
+	}
+} end_tests;
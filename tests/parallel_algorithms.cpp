@@ -0,0 +1,218 @@
+#include <assertions-test/test.h>
+#include <parallel_algorithms.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when executing parallel for loops") {
+		test_case("every index should be visited exactly once") {
+			thread_pool pool(4);
+			vector<atomic<int>> visits(10000);
+
+			parallel_for(pool, 0, 10000, [&](int index) {
+				visits[index]++;
+			});
+
+			bool visited_once = true;
+			for (auto& visit_count : visits) {
+				if (visit_count != 1) {
+					visited_once = false;
+				}
+			}
+			assert(visited_once, ==, true);
+		};
+
+		test_case("every element of a range should be visited") {
+			thread_pool pool(4);
+			vector<int> values(10000, 1);
+
+			parallel_for(pool, values, [](int& value) {
+				value *= 2;
+			});
+
+			assert(accumulate(values.begin(), values.end(), 0), ==, 20000);
+		};
+
+		test_case("the number of submitted tasks should depend on the number of chunks instead of the number of elements") {
+			thread_pool pool(2);
+			atomic<int> executed_chunks(0);
+
+			parallel_for(pool, 0, 1000, [&](int index) {
+				if (index%100 == 0) {
+					executed_chunks++;
+				}
+			}, grain_size{100});
+
+			assert(executed_chunks, ==, 10);
+		};
+
+		test_case("an exception should be propagated to the caller and cancel the remaining chunks") {
+			thread_pool pool(2);
+			atomic<int> visited_indices(0);
+			bool exception_propagated = false;
+
+			try {
+				parallel_for(pool, 0, 100000, [&](int index) {
+					visited_indices++;
+					if (index == 0) {
+						throw runtime_error("failed");
+					}
+				}, grain_size{10});
+			} catch (const runtime_error&) {
+				exception_propagated = true;
+			}
+
+			assert(exception_propagated, ==, true);
+			assert(visited_indices, <, 100000);
+		};
+
+		test_case("empty ranges should not execute the function") {
+			thread_pool pool(2);
+			atomic<int> visited_indices(0);
+
+			parallel_for(pool, 5, 5, [&](int) {
+				visited_indices++;
+			});
+
+			assert(visited_indices, ==, 0);
+		};
+
+		test_case("parallel loops should not deadlock when executed from inside the pool") {
+			thread_pool pool(1);
+			atomic<int> visited_indices(0);
+
+			auto future = pool.exec([&] {
+				parallel_for(pool, 0, 1000, [&](int) {
+					visited_indices++;
+				});
+			});
+			future.get();
+
+			assert(visited_indices, ==, 1000);
+		};
+
+		test_case("cancelling the token should skip the remaining chunks and report the cancellation") {
+			thread_pool pool(2);
+			cancellation_source source;
+			atomic<int> visited_indices(0);
+			bool cancellation_reported = false;
+
+			try {
+				parallel_for(pool, source.get_token(), 0, 100000, [&](int) {
+					if (visited_indices++ == 0) {
+						source.cancel();
+					}
+				}, grain_size{10});
+			} catch (const task_cancelled&) {
+				cancellation_reported = true;
+			}
+
+			assert(cancellation_reported, ==, true);
+			assert(visited_indices, <, 100000);
+		};
+	}
+
+	test_suite("when transforming ranges in parallel") {
+		test_case("every element should be transformed into the output") {
+			thread_pool pool(4);
+			vector<int> input(10000);
+			iota(input.begin(), input.end(), 0);
+			vector<long> output(input.size());
+
+			auto output_end = parallel_transform(pool, input, output.begin(), [](int value) {
+				return (long)value*value;
+			});
+
+			bool transformed = true;
+			for (size_t i = 0; i < input.size(); i++) {
+				if (output[i] != long(i)*long(i)) {
+					transformed = false;
+				}
+			}
+			assert(transformed, ==, true);
+			assert(output_end == output.end(), ==, true);
+		};
+	}
+
+	test_suite("when reducing ranges in parallel") {
+		test_case("the result should be the same as a serial reduction") {
+			thread_pool pool(4);
+			vector<long> values(100000);
+			iota(values.begin(), values.end(), 1);
+
+			auto sum = parallel_reduce(pool, values, 0l, [](long a, long b) {
+				return a + b;
+			});
+
+			assert(sum, ==, 5000050000l);
+		};
+
+		test_case("non commutative operations should keep the order of the elements") {
+			thread_pool pool(4);
+			vector<string> letters;
+			for (char letter = 'a'; letter <= 'z'; letter++) {
+				letters.emplace_back(1, letter);
+			}
+
+			auto word = parallel_reduce(pool, letters, string(">"), [](string a, const string& b) {
+				return a + b;
+			}, grain_size{3});
+
+			assert(word, ==, ">abcdefghijklmnopqrstuvwxyz");
+		};
+
+		test_case("an expired deadline should report the cancellation without reducing") {
+			thread_pool pool(2);
+			vector<int> input(1000, 1);
+			auto token = cancellation_token().with_deadline(chrono::steady_clock::now());
+			bool deadline_reported = false;
+
+			try {
+				parallel_reduce(pool, token, input, 0, plus<int>());
+			} catch (const deadline_exceeded&) {
+				deadline_reported = true;
+			}
+
+			assert(deadline_reported, ==, true);
+		};
+
+		test_case("reducing an empty range should return the initial value") {
+			thread_pool pool(2);
+			vector<int> values;
+
+			auto sum = parallel_reduce(pool, values, 7, [](int a, int b) {
+				return a + b;
+			});
+
+			assert(sum, ==, 7);
+		};
+	}
+
+	test_suite("when scanning ranges in parallel") {
+		test_case("the output should hold the inclusive prefix sums of the input") {
+			thread_pool pool(4);
+			vector<long> input(10000, 1);
+			vector<long> output(input.size());
+
+			parallel_scan(pool, input, output.begin(), 10l, [](long a, long b) {
+				return a + b;
+			}, grain_size{7});
+
+			bool scanned = true;
+			for (size_t i = 0; i < output.size(); i++) {
+				if (output[i] != (long)i + 11) {
+					scanned = false;
+				}
+			}
+			assert(scanned, ==, true);
+		};
+	}
+} end_tests;
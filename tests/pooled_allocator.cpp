@@ -0,0 +1,61 @@
+#include <assertions-test/test.h>
+#include <pooled_allocator.h>
+#include <future>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+begin_tests {
+	test_suite("when allocating single objects") {
+		test_case("released memory should be reused") {
+			parallel_tools::pooled_allocator<long> allocator;
+			auto first = allocator.allocate(1);
+			allocator.deallocate(first, 1);
+			auto second = allocator.allocate(1);
+			allocator.deallocate(second, 1);
+
+			assert(first == second, ==, true);
+		};
+
+		test_case("memory released by other threads should be reused") {
+			parallel_tools::pooled_allocator<double> allocator;
+			vector<double*> pointers;
+			for (int i = 0; i < 1000; i++) {
+				pointers.push_back(allocator.allocate(1));
+			}
+			async(launch::async, [&] {
+				for (auto pointer : pointers) {
+					allocator.deallocate(pointer, 1);
+				}
+			}).wait();
+
+			bool reused = false;
+			auto pointer = allocator.allocate(1);
+			for (auto released_pointer : pointers) {
+				if (pointer == released_pointer) {
+					reused = true;
+				}
+			}
+			allocator.deallocate(pointer, 1);
+
+			assert(reused, ==, true);
+		};
+	}
+
+	test_suite("when using the allocator with standard library types") {
+		test_case("shared states should be allocated from the pool") {
+			promise<int> value_promise(allocator_arg, parallel_tools::pooled_allocator<int>());
+			auto future = value_promise.get_future();
+			value_promise.set_value(3);
+
+			assert(future.get(), ==, 3);
+		};
+
+		test_case("arrays should be allocated") {
+			vector<int, parallel_tools::pooled_allocator<int>> values(100, 2);
+
+			assert(values[99], ==, 2);
+		};
+	}
+} end_tests;
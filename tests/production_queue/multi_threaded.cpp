@@ -1,6 +1,8 @@
 #include <assertions-test/test.h>
 #include <production_queue.h>
+#include <ctime>
 #include <future>
+#include <type_traits>
 #include <stopwatch/stopwatch.h>
 
 using namespace std;
@@ -291,5 +293,730 @@ begin_tests {
 			assert(stopwatch.lap_time(), <=, 250ms);
 		};
 	}
-} end_tests;
 
+	test_suite("when using a ring buffer backend") {
+		using ring_queue = parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer>;
+
+		test_case("consumption should block until a resource is available") {
+			ring_queue queue(4);
+			bool blocked = true;
+
+			auto future = async(launch::async, [&] {
+				queue.consume();
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			queue.produce(10);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+		};
+
+		test_case("production should block while the ring is full") {
+			ring_queue queue(2);
+			bool blocked = true;
+
+			queue.produce(1);
+			queue.produce(2);
+			auto future = async(launch::async, [&] {
+				queue.produce(3);
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			assert(queue.consume(), ==, 1);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+			assert(queue.consume(), ==, 2);
+			assert(queue.consume(), ==, 3);
+		};
+	}
+
+	test_suite("when stressing a ring buffer with 4 consumers, 4 producers and 1,000,000 resources") {
+		const int resources_count = 1'000'000;
+		const int consumers_count = 4;
+		const int producers_count = 4;
+
+		test_case("all resources should be consumed only once in less than 500ms") {
+			vector<atomic<unsigned>> consumption_counts(resources_count);
+			vector<thread> consumers;
+			vector<thread> producers;
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(1024);
+			atomic<int> running_producers(producers_count);
+
+			for (auto& count : consumption_counts) {
+				count.store(0);
+			}
+
+			stopwatch stopwatch;
+			for (int i = 0; i < producers_count; i++) {
+				producers.emplace_back([&, i] {
+					for (int j = i; j < resources_count; j += producers_count) {
+						queue.produce(j);
+					}
+					running_producers--;
+					if (running_producers == 0) {
+						for (int j = 0; j < consumers_count; j++) {
+							queue.produce(-1);
+						}
+					}
+				});
+			}
+
+			for (int i = 0; i < consumers_count; i++) {
+				consumers.emplace_back([&] {
+					while (true) {
+						auto count_index = queue.consume();
+						if (count_index == -1) break;
+						consumption_counts[count_index]++;
+					}
+				});
+			}
+
+			for (auto& consumer : consumers) {
+				consumer.join();
+			}
+			for (auto& producer : producers) {
+				producer.join();
+			}
+
+			for (auto& consumption_count : consumption_counts) {
+				assert(consumption_count, ==, 1);
+			}
+			assert(stopwatch.lap_time(), <=, 500ms);
+		};
+	}
+
+	test_suite("when using a single producer single consumer backend") {
+		using spsc_queue = parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc>;
+
+		test_case("consumption should block until a resource is available") {
+			spsc_queue queue(4);
+			bool blocked = true;
+
+			auto future = async(launch::async, [&] {
+				queue.consume();
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			queue.produce(10);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+		};
+
+		test_case("production should block while the queue is full") {
+			spsc_queue queue(2);
+			bool blocked = true;
+
+			queue.produce(1);
+			queue.produce(2);
+			auto future = async(launch::async, [&] {
+				queue.produce(3);
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			assert(queue.consume(), ==, 1);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+			assert(queue.consume(), ==, 2);
+			assert(queue.consume(), ==, 3);
+		};
+
+		test_case("waiting consumers should spin briefly and then park by default") {
+			spsc_queue queue(4);
+			auto thread_cpu_time = [] {
+				timespec time;
+				clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+				return chrono::seconds(time.tv_sec) + chrono::nanoseconds(time.tv_nsec);
+			};
+
+			auto future = async(launch::async, [&] {
+				auto cpu_time_before = thread_cpu_time();
+				queue.consume();
+				return thread_cpu_time() - cpu_time_before;
+			});
+			this_thread::sleep_for(50ms);
+			queue.produce(10);
+
+			assert((is_same<parallel_tools::queue_backend::spsc::default_wait_strategy, parallel_tools::wait_strategy::spin_then_park>::value), ==, true);
+			assert(future.get(), <=, 10ms);
+		};
+
+		test_case("1,000,000 resources should be consumed in first-in-first-out order in less than 250ms") {
+			const int resources_count = 1'000'000;
+			spsc_queue queue(1024);
+			bool in_order = true;
+
+			stopwatch stopwatch;
+			thread producer([&] {
+				for (int i = 0; i < resources_count; i++) {
+					queue.produce(i);
+				}
+			});
+
+			for (int i = 0; i < resources_count; i++) {
+				in_order &= queue.consume() == i;
+			}
+			producer.join();
+
+			assert(in_order, ==, true);
+			assert(stopwatch.lap_time(), <=, 250ms);
+		};
+	}
+
+	test_suite("when producing and consuming in bulk") {
+		test_case("consuming a batch should block until a resource is available") {
+			parallel_tools::production_queue<int> queue;
+			bool blocked = true;
+			vector<int> consumed_resources;
+
+			auto future = async(launch::async, [&] {
+				queue.consume_batch(back_inserter(consumed_resources), 4);
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			queue.produce_bulk(vector<int>{ 1, 2 });
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+			assert(consumed_resources.size(), ==, 2);
+		};
+
+		test_case("1,000,000 resources produced and consumed in batches of 256 should all be consumed only once in less than 250ms") {
+			const int resources_count = 1'000'000;
+			const int batch_size = 256;
+			const int consumers_count = 2;
+			vector<atomic<unsigned>> consumption_counts(resources_count);
+			vector<thread> consumers;
+			parallel_tools::production_queue<int> queue;
+
+			for (auto& count : consumption_counts) {
+				count.store(0);
+			}
+
+			stopwatch stopwatch;
+			thread producer([&] {
+				vector<int> batch;
+				batch.reserve(batch_size);
+				for (int i = 0; i < resources_count; i++) {
+					batch.push_back(i);
+					if (batch.size() == batch_size || i == resources_count-1) {
+						queue.produce_range(batch.begin(), batch.end());
+						batch.clear();
+					}
+				}
+				for (int i = 0; i < consumers_count; i++) {
+					queue.produce(-1);
+				}
+			});
+
+			for (int i = 0; i < consumers_count; i++) {
+				consumers.emplace_back([&] {
+					vector<int> batch(batch_size);
+					int consumed_terminators = 0;
+					while (consumed_terminators == 0) {
+						auto consumed = queue.consume_batch(batch.begin(), batch_size);
+						for (size_t j = 0; j < consumed; j++) {
+							if (batch[j] == -1) {
+								consumed_terminators++;
+							} else {
+								consumption_counts[batch[j]]++;
+							}
+						}
+					}
+					for (int j = 1; j < consumed_terminators; j++) {
+						queue.produce(-1);
+					}
+				});
+			}
+
+			producer.join();
+			for (auto& consumer : consumers) {
+				consumer.join();
+			}
+
+			for (auto& consumption_count : consumption_counts) {
+				assert(consumption_count, ==, 1);
+			}
+			assert(stopwatch.lap_time(), <=, 250ms);
+		};
+	}
+
+	test_suite("when producing into a queue with limited capacity") {
+		test_case("production should block while the queue is full") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(2);
+			bool blocked = true;
+
+			queue.produce(1);
+			queue.produce(2);
+			auto future = async(launch::async, [&] {
+				queue.produce(3);
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			assert(queue.consume(), ==, 1);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+		};
+
+		test_case("raising the capacity should unblock producers") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(1);
+			bool blocked = true;
+
+			queue.produce(1);
+			auto future = async(launch::async, [&] {
+				queue.produce(2);
+				blocked = false;
+			});
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, true);
+
+			queue.limit_capacity(2);
+			this_thread::sleep_for(5ms);
+			assert(blocked, ==, false);
+
+			future.wait();
+		};
+
+		test_case("1,000,000 resources produced into a capacity of 1024 should all be consumed only once") {
+			const int resources_count = 1'000'000;
+			const int producers_count = 2;
+			vector<atomic<unsigned>> consumption_counts(resources_count);
+			vector<thread> producers;
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(1024);
+
+			for (auto& count : consumption_counts) {
+				count.store(0);
+			}
+
+			for (int i = 0; i < producers_count; i++) {
+				producers.emplace_back([&, i] {
+					for (int j = i; j < resources_count; j += producers_count) {
+						queue.produce(j);
+					}
+				});
+			}
+
+			for (int i = 0; i < resources_count; i++) {
+				consumption_counts[queue.consume()]++;
+			}
+
+			for (auto& producer : producers) {
+				producer.join();
+			}
+
+			for (auto& consumption_count : consumption_counts) {
+				assert(consumption_count, ==, 1);
+			}
+		};
+	}
+
+	test_suite("when consuming with a timeout") {
+		test_case("consumption should give up once the timeout expires") {
+			parallel_tools::production_queue<int> queue;
+
+			stopwatch stopwatch;
+			auto resource = queue.consume_for(10ms);
+
+			assert(resource.has_value(), ==, false);
+			assert(stopwatch.lap_time(), >=, 10ms);
+		};
+
+		test_case("consumption should return a resource produced before the timeout expires") {
+			parallel_tools::production_queue<int> queue;
+
+			auto producer_future = async(launch::async, [&] {
+				this_thread::sleep_for(5ms);
+				queue.produce(10);
+			});
+
+			auto resource = queue.consume_for(100ms);
+			producer_future.wait();
+
+			assert(resource.has_value(), ==, true);
+			assert(*resource, ==, 10);
+		};
+
+		test_case("consumption should swap buffers once the flush policy allows it") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::batches_of{2});
+			queue.produce(10);
+
+			auto producer_future = async(launch::async, [&] {
+				this_thread::sleep_for(5ms);
+				queue.produce(9);
+			});
+
+			auto resource = queue.consume_until(chrono::steady_clock::now() + 100ms);
+			producer_future.wait();
+
+			assert(resource.has_value(), ==, true);
+			assert(*resource, ==, 10);
+		};
+
+		test_case("consumption from a ring buffer should give up once the timeout expires") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(4);
+
+			stopwatch stopwatch;
+			auto resource = queue.consume_for(10ms);
+
+			assert(resource.has_value(), ==, false);
+			assert(stopwatch.lap_time(), >=, 10ms);
+		};
+
+		test_case("consumption from a single producer single consumer queue should return a resource produced before the timeout expires") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc> queue(4);
+
+			auto producer_future = async(launch::async, [&] {
+				this_thread::sleep_for(5ms);
+				queue.produce(10);
+			});
+
+			auto resource = queue.consume_for(100ms);
+			producer_future.wait();
+
+			assert(resource.has_value(), ==, true);
+			assert(*resource, ==, 10);
+		};
+	}
+
+	test_suite("when closing a queue") {
+		test_case("blocked consumers should wake up and report the end of the stream") {
+			parallel_tools::production_queue<int> queue;
+			atomic<int> ended_consumers(0);
+
+			auto consume_until_closed = [&] {
+				try {
+					queue.consume();
+				} catch (const parallel_tools::queue_closed&) {
+					ended_consumers++;
+				}
+			};
+			auto future1 = async(launch::async, consume_until_closed);
+			auto future2 = async(launch::async, consume_until_closed);
+			this_thread::sleep_for(5ms);
+			assert(ended_consumers, ==, 0);
+
+			queue.close();
+			future1.wait();
+			future2.wait();
+
+			assert(ended_consumers, ==, 2);
+		};
+
+		test_case("blocked producers should wake up and fail") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(1);
+			queue.produce(1);
+
+			auto future = async(launch::async, [&] {
+				return queue.produce(2);
+			});
+			this_thread::sleep_for(5ms);
+
+			queue.close();
+
+			assert(future.get(), ==, false);
+		};
+
+		test_case("blocked ring buffer consumers should wake up and report the end of the stream") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(4);
+			bool end_reported = false;
+
+			auto future = async(launch::async, [&] {
+				try {
+					queue.consume();
+				} catch (const parallel_tools::queue_closed&) {
+					end_reported = true;
+				}
+			});
+			this_thread::sleep_for(5ms);
+
+			queue.close();
+			future.wait();
+
+			assert(end_reported, ==, true);
+		};
+
+		test_case("ring buffer consumers should receive every resource accepted before the close") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(64);
+			atomic<int> accepted_resources(0);
+			atomic<int> consumed_resources(0);
+
+			auto produce_until_closed = [&] {
+				while (queue.produce(1)) {
+					accepted_resources++;
+				}
+			};
+			auto consume_until_closed = [&] {
+				try {
+					while (true) {
+						consumed_resources += queue.consume();
+					}
+				} catch (const parallel_tools::queue_closed&) {
+				}
+			};
+			vector<future<void>> futures;
+			for (int i = 0; i < 4; i++) {
+				futures.push_back(async(launch::async, produce_until_closed));
+				futures.push_back(async(launch::async, consume_until_closed));
+			}
+			this_thread::sleep_for(20ms);
+
+			queue.close();
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(consumed_resources.load(), ==, accepted_resources.load());
+		};
+	}
+	test_suite("when using different wait strategies") {
+		auto transfer_resources = [](auto& queue) {
+			auto consumer = async(launch::async, [&] {
+				long sum = 0;
+				for (int i = 0; i < 10000; i++) {
+					sum += queue.consume();
+				}
+				return sum;
+			});
+			for (int i = 0; i < 10000; i++) {
+				queue.produce(i);
+			}
+			return consumer.get();
+		};
+
+		test_case("a busy spinning queue should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::double_buffer, parallel_tools::wait_strategy::busy_spin> queue;
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a spinning then yielding queue should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::double_buffer, parallel_tools::wait_strategy::spin_then_yield> queue;
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a spinning then parking queue should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::double_buffer, parallel_tools::wait_strategy::spin_then_park> queue;
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a blocking queue should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::double_buffer, parallel_tools::wait_strategy::blocking> queue;
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a blocking ring buffer should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer, parallel_tools::wait_strategy::blocking> queue(8);
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a yielding single producer single consumer queue should deliver every resource") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc, parallel_tools::wait_strategy::spin_then_yield> queue(8);
+			assert(transfer_resources(queue), ==, 49995000l);
+		};
+
+		test_case("a parked consumer should wake up when a resource is produced") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::double_buffer, parallel_tools::wait_strategy::spin_then_park> queue;
+
+			auto future = async(launch::async, [&] {
+				return queue.consume();
+			});
+			this_thread::sleep_for(5ms);
+			queue.produce(42);
+
+			assert(future.get(), ==, 42);
+		};
+
+		test_case("a parked consumer should time out when nothing is produced") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer, parallel_tools::wait_strategy::spin_then_park> queue(4);
+			assert(queue.consume_for(5ms).has_value(), ==, false);
+		};
+	}
+
+	test_suite("when producing from many threads into sharded producer buffers") {
+		test_case("every resource should be consumed and each producer's order should be kept") {
+			constexpr int producers = 8;
+			constexpr int resources_per_producer = 10000;
+			parallel_tools::production_queue<pair<int, int>> queue(parallel_tools::queue_backend::double_buffer{4});
+
+			vector<future<void>> futures;
+			for (int producer = 0; producer < producers; producer++) {
+				futures.push_back(async(launch::async, [&, producer] {
+					for (int i = 0; i < resources_per_producer; i++) {
+						queue.produce(make_pair(producer, i));
+					}
+				}));
+			}
+
+			vector<int> next_resource(producers, 0);
+			bool ordered = true;
+			for (int i = 0; i < producers*resources_per_producer; i++) {
+				auto resource = queue.consume();
+				if (resource.second != next_resource[resource.first]) {
+					ordered = false;
+				}
+				next_resource[resource.first] = resource.second + 1;
+			}
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(ordered, ==, true);
+			for (int producer = 0; producer < producers; producer++) {
+				assert(next_resource[producer], ==, resources_per_producer);
+			}
+		};
+
+		test_case("blocked producers on different shards should all be released") {
+			parallel_tools::production_queue<int> queue(parallel_tools::queue_backend::double_buffer{4});
+			queue.limit_capacity(2);
+
+			vector<future<void>> futures;
+			for (int producer = 0; producer < 4; producer++) {
+				futures.push_back(async(launch::async, [&] {
+					for (int i = 0; i < 100; i++) {
+						queue.produce(1);
+					}
+				}));
+			}
+
+			int sum = 0;
+			for (int i = 0; i < 400; i++) {
+				sum += queue.consume();
+			}
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(sum, ==, 400);
+			assert(queue.try_consume().has_value(), ==, false);
+		};
+	}
+
+	test_suite("when using time based and adaptive flush policies") {
+		test_case("a blocked consumer should receive an incomplete batch once it reaches the maximum latency") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::max_latency{5ms});
+
+			auto future = async(launch::async, [&] {
+				return queue.consume();
+			});
+			this_thread::sleep_for(1ms);
+			queue.produce(7);
+
+			assert(future.wait_for(500ms) == future_status::ready, ==, true);
+			assert(future.get(), ==, 7);
+		};
+
+		test_case("consuming with a timeout should receive resources which reach the maximum latency in time") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::max_latency{5ms});
+			queue.produce(7);
+
+			assert(queue.consume_for(500ms).value_or(0), ==, 7);
+		};
+
+		test_case("consuming with a timeout should not wait for a maximum latency past the timeout") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::max_latency{1h});
+			queue.produce(7);
+
+			assert(queue.consume_for(5ms).has_value(), ==, false);
+		};
+
+		test_case("an adaptive policy should deliver every resource from many producers") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::adaptive{1, 256, 1ms});
+
+			vector<future<void>> futures;
+			for (int producer = 0; producer < 4; producer++) {
+				futures.push_back(async(launch::async, [&] {
+					for (int i = 0; i < 25000; i++) {
+						queue.produce(1);
+					}
+				}));
+			}
+			auto consumer1 = async(launch::async, [&] {
+				int sum = 0;
+				for (int i = 0; i < 50000; i++) {
+					sum += queue.consume();
+				}
+				return sum;
+			});
+			auto consumer2 = async(launch::async, [&] {
+				int sum = 0;
+				for (int i = 0; i < 50000; i++) {
+					sum += queue.consume();
+				}
+				return sum;
+			});
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(consumer1.get() + consumer2.get(), ==, 100000);
+		};
+	}
+
+	test_suite("when using a priority backend") {
+		test_case("a blocked consumer should wake up when a resource is produced") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(4);
+
+			auto future = async(launch::async, [&] {
+				return queue.consume();
+			});
+			this_thread::sleep_for(5ms);
+			queue.produce(parallel_tools::priority{3}, 42);
+
+			assert(future.get(), ==, 42);
+		};
+
+		test_case("every resource should be consumed with 4 producers and 2 consumers") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(parallel_tools::queue_backend::priority_levels{4, 1ms});
+
+			vector<future<void>> producers;
+			for (int producer = 0; producer < 4; producer++) {
+				producers.push_back(async(launch::async, [&, producer] {
+					for (int i = 0; i < 25000; i++) {
+						queue.produce(parallel_tools::priority{size_t((i + producer) % 4)}, 1);
+					}
+				}));
+			}
+			auto consume_half = [&] {
+				int sum = 0;
+				for (int i = 0; i < 50000; i++) {
+					sum += queue.consume();
+				}
+				return sum;
+			};
+			auto consumer1 = async(launch::async, consume_half);
+			auto consumer2 = async(launch::async, consume_half);
+			for (auto& producer : producers) {
+				producer.wait();
+			}
+
+			assert(consumer1.get() + consumer2.get(), ==, 100000);
+			assert(queue.get_available_resources(), ==, 0u);
+		};
+	}
+} end_tests;
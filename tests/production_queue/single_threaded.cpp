@@ -1,6 +1,7 @@
 #include <assertions-test/test.h>
 #include <production_queue.h>
 #include <vector>
+#include <memory>
 
 using namespace std;
 begin_tests {
@@ -79,5 +80,419 @@ begin_tests {
 			}
 		};
 	}
-} end_tests;
 
+	test_suite("when using a ring buffer backend") {
+		test_case("capacity should be rounded up to a power of two") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(5);
+			assert(queue.get_capacity(), ==, 8);
+		};
+
+		test_case("consuming should return items in a first-in-first-out order") {
+			vector<int> resources{ 10, 9, 15, 4 };
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(4);
+
+			for (int refill = 0; refill < 3; refill++) {
+				for (auto resource : resources) {
+					queue.produce(resource);
+				}
+				assert(queue.get_available_resources(), ==, resources.size());
+				for (size_t i = 0; i < resources.size(); i++) {
+					auto consumed_resource = queue.consume();
+					assert(consumed_resource, ==, resources[i]);
+				}
+			}
+		};
+	}
+
+	test_suite("when using a single producer single consumer backend") {
+		test_case("consuming should return items in a first-in-first-out order") {
+			vector<int> resources{ 10, 9, 15, 4 };
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc> queue(4);
+
+			for (int refill = 0; refill < 3; refill++) {
+				for (auto resource : resources) {
+					queue.produce(resource);
+				}
+				assert(queue.get_available_resources(), ==, resources.size());
+				for (size_t i = 0; i < resources.size(); i++) {
+					auto consumed_resource = queue.consume();
+					assert(consumed_resource, ==, resources[i]);
+				}
+			}
+		};
+	}
+
+	test_suite("when producing and consuming in bulk") {
+		test_case("consuming a batch should return items produced from a range in first-in-first-out order") {
+			vector<int> resources{ 10, 9, 15, 4 };
+			parallel_tools::production_queue<int> queue;
+
+			queue.produce_range(resources.begin(), resources.end());
+			assert(queue.get_unpublished_resources(), ==, resources.size());
+
+			vector<int> consumed_resources;
+			auto consumed_count = queue.consume_batch(back_inserter(consumed_resources), resources.size());
+
+			assert(consumed_count, ==, resources.size());
+			for (size_t i = 0; i < resources.size(); i++) {
+				assert(consumed_resources[i], ==, resources[i]);
+			}
+		};
+
+		test_case("consuming a batch should return no more than the requested number of items") {
+			parallel_tools::production_queue<int> queue;
+			queue.produce_bulk(vector<int>{ 1, 2, 3, 4, 5 });
+
+			vector<int> consumed_resources(3);
+			auto consumed_count = queue.consume_batch(consumed_resources.begin(), 3);
+
+			assert(consumed_count, ==, 3);
+			for (int i = 0; i < 3; i++) {
+				assert(consumed_resources[i], ==, i+1);
+			}
+			assert(queue.get_available_resources(), ==, 2);
+		};
+
+		test_case("consuming a batch should return no more than the currently available items") {
+			parallel_tools::production_queue<int> queue;
+			queue.produce_bulk(vector<int>{ 1, 2 });
+
+			vector<int> consumed_resources;
+			auto consumed_count = queue.consume_batch(back_inserter(consumed_resources), 10);
+
+			assert(consumed_count, ==, 2);
+			assert(consumed_resources[0], ==, 1);
+			assert(consumed_resources[1], ==, 2);
+		};
+
+		test_case("producing in bulk should move resources out of the container") {
+			parallel_tools::production_queue<unique_ptr<int>> queue;
+			vector<unique_ptr<int>> resources;
+			resources.emplace_back(new int(7));
+
+			queue.produce_bulk(std::move(resources));
+
+			assert(*queue.consume(), ==, 7);
+		};
+	}
+
+	test_suite("when producing into a queue with limited capacity") {
+		test_case("trying to produce should fail once both buffers together reach the capacity") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(3);
+
+			assert(queue.try_produce(1), ==, true);
+			assert(queue.try_produce(2), ==, true);
+			queue.consume();
+			assert(queue.try_produce(3), ==, true);
+			assert(queue.try_produce(4), ==, true);
+			assert(queue.try_produce(5), ==, false);
+
+			queue.consume();
+			assert(queue.try_produce(5), ==, true);
+		};
+
+		test_case("fail policy should reject resources produced beyond the capacity") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(2, parallel_tools::overflow_policy::fail);
+
+			assert(queue.produce(1), ==, true);
+			assert(queue.produce(2), ==, true);
+			assert(queue.produce(3), ==, false);
+			assert(queue.get_unpublished_resources(), ==, 2);
+		};
+
+		test_case("drop newest policy should discard resources produced beyond the capacity") {
+			vector<int> resources{ 1, 2, 3, 4 };
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(2, parallel_tools::overflow_policy::drop_newest);
+
+			auto produced = queue.produce_range(resources.begin(), resources.end());
+
+			assert(produced, ==, 2);
+			assert(queue.consume(), ==, 1);
+			assert(queue.consume(), ==, 2);
+			assert(queue.get_available_resources(), ==, 0);
+		};
+
+		test_case("drop oldest policy should discard the oldest resources to make room for new ones") {
+			parallel_tools::production_queue<int> queue;
+			queue.limit_capacity(3, parallel_tools::overflow_policy::drop_oldest);
+
+			queue.produce(1);
+			queue.produce(2);
+			assert(queue.consume(), ==, 1);
+			queue.produce(3);
+			queue.produce(4);
+			queue.produce(5);
+
+			assert(queue.consume(), ==, 3);
+			assert(queue.consume(), ==, 4);
+			assert(queue.consume(), ==, 5);
+		};
+	}
+
+	test_suite("when trying to consume without blocking") {
+		test_case("should return nothing if the queue is empty") {
+			parallel_tools::production_queue<int> queue;
+			assert(queue.try_consume().has_value(), ==, false);
+		};
+
+		test_case("should return resources in first-in-first-out order") {
+			parallel_tools::production_queue<int> queue;
+			queue.produce(10);
+			queue.produce(9);
+
+			assert(*queue.try_consume(), ==, 10);
+			assert(*queue.try_consume(), ==, 9);
+			assert(queue.try_consume().has_value(), ==, false);
+		};
+
+		test_case("should only swap buffers when the flush policy allows it") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::batches_of{2});
+
+			queue.produce(10);
+			assert(queue.try_consume().has_value(), ==, false);
+
+			queue.produce(9);
+			assert(*queue.try_consume(), ==, 10);
+		};
+
+		test_case("should work with the ring buffer backend") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(4);
+			assert(queue.try_consume().has_value(), ==, false);
+
+			queue.produce(10);
+			assert(*queue.try_consume(), ==, 10);
+		};
+
+		test_case("should work with the single producer single consumer backend") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc> queue(4);
+			assert(queue.try_consume().has_value(), ==, false);
+
+			queue.produce(10);
+			assert(*queue.try_consume(), ==, 10);
+		};
+	}
+
+	test_suite("when closing a queue") {
+		test_case("production should fail") {
+			parallel_tools::production_queue<int> queue;
+			queue.close();
+
+			assert(queue.produce(10), ==, false);
+			assert(queue.get_unpublished_resources(), ==, 0);
+		};
+
+		test_case("remaining resources should be consumed regardless of the flush policy") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::never);
+			queue.produce(10);
+			queue.produce(9);
+			queue.close();
+
+			assert(queue.consume(), ==, 10);
+			assert(queue.consume(), ==, 9);
+		};
+
+		test_case("consumption should report the end of the stream once all resources were consumed") {
+			parallel_tools::production_queue<int> queue;
+			queue.produce(10);
+			queue.close();
+
+			queue.consume();
+			bool end_reported = false;
+			try {
+				queue.consume();
+			} catch (const parallel_tools::queue_closed&) {
+				end_reported = true;
+			}
+
+			assert(end_reported, ==, true);
+			assert(queue.try_consume().has_value(), ==, false);
+		};
+
+		test_case("ring buffer consumption should report the end of the stream once all resources were consumed") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::ring_buffer> queue(4);
+			queue.produce(10);
+			queue.close();
+
+			assert(queue.produce(9), ==, false);
+			assert(queue.consume(), ==, 10);
+			bool end_reported = false;
+			try {
+				queue.consume();
+			} catch (const parallel_tools::queue_closed&) {
+				end_reported = true;
+			}
+
+			assert(end_reported, ==, true);
+		};
+
+		test_case("single producer single consumer consumption should report the end of the stream once all resources were consumed") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::spsc> queue(4);
+			queue.produce(10);
+			queue.close();
+
+			assert(queue.produce(9), ==, false);
+			assert(queue.consume(), ==, 10);
+			bool end_reported = false;
+			try {
+				queue.consume();
+			} catch (const parallel_tools::queue_closed&) {
+				end_reported = true;
+			}
+
+			assert(end_reported, ==, true);
+		};
+	}
+
+	test_suite("when producing into sharded producer buffers") {
+		test_case("resources produced by a single thread should be consumed in order") {
+			parallel_tools::production_queue<int> queue(parallel_tools::queue_backend::double_buffer{4});
+			for (int i = 0; i < 10; i++) {
+				queue.produce(i);
+			}
+
+			for (int i = 0; i < 10; i++) {
+				assert(queue.consume(), ==, i);
+			}
+		};
+
+		test_case("unpublished resources should follow the flush policy") {
+			parallel_tools::production_queue<int> queue(parallel_tools::queue_backend::double_buffer{4}, parallel_tools::flush_policy::batches_of{3});
+			queue.produce(1);
+			queue.produce(2);
+
+			assert(queue.try_consume().has_value(), ==, false);
+			assert(queue.get_unpublished_resources(), ==, 2u);
+
+			queue.produce(3);
+
+			assert(queue.consume(), ==, 1);
+			assert(queue.get_unpublished_resources(), ==, 0u);
+			assert(queue.get_available_resources(), ==, 2u);
+		};
+
+		test_case("dropping the oldest resource should respect capacity") {
+			parallel_tools::production_queue<int> queue(parallel_tools::queue_backend::double_buffer{4});
+			queue.limit_capacity(2, parallel_tools::overflow_policy::drop_oldest);
+			queue.produce(1);
+			queue.produce(2);
+			queue.produce(3);
+
+			assert(queue.consume(), ==, 2);
+			assert(queue.consume(), ==, 3);
+		};
+	}
+
+	test_suite("when using time based and adaptive flush policies") {
+		test_case("resources younger than the maximum latency should not be published") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::max_latency{1h});
+			queue.produce(1);
+
+			assert(queue.try_consume().has_value(), ==, false);
+			assert(queue.get_unpublished_resources(), ==, 1u);
+		};
+
+		test_case("resources older than the maximum latency should be published") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::max_latency{5ms});
+			queue.produce(1);
+			queue.produce(2);
+			this_thread::sleep_for(10ms);
+
+			assert(queue.try_consume().value_or(0), ==, 1);
+			assert(queue.try_consume().value_or(0), ==, 2);
+		};
+
+		test_case("an adaptive policy should publish once its minimum batch is complete") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::adaptive{3, 64, 1h});
+			queue.produce(1);
+			queue.produce(2);
+
+			assert(queue.try_consume().has_value(), ==, false);
+
+			queue.produce(3);
+
+			assert(queue.try_consume().value_or(0), ==, 1);
+		};
+
+		test_case("an adaptive policy should publish incomplete batches once they reach its latency") {
+			parallel_tools::production_queue<int> queue(parallel_tools::flush_policy::adaptive{3, 64, 5ms});
+			queue.produce(1);
+			this_thread::sleep_for(10ms);
+
+			assert(queue.try_consume().value_or(0), ==, 1);
+		};
+	}
+
+	test_suite("when using a priority backend") {
+		test_case("resources with higher priority should be consumed first") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(3);
+			queue.produce(parallel_tools::priority{0}, 1);
+			queue.produce(parallel_tools::priority{2}, 3);
+			queue.produce(parallel_tools::priority{1}, 2);
+
+			assert(queue.consume(), ==, 3);
+			assert(queue.consume(), ==, 2);
+			assert(queue.consume(), ==, 1);
+		};
+
+		test_case("resources with the same priority should be consumed in order") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(3);
+			for (int i = 0; i < 10; i++) {
+				queue.produce(parallel_tools::priority{1}, i);
+			}
+
+			for (int i = 0; i < 10; i++) {
+				assert(queue.consume(), ==, i);
+			}
+		};
+
+		test_case("resources without a priority should have the lowest priority") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(2);
+			queue.produce(1);
+			queue.produce(parallel_tools::priority{1}, 2);
+
+			assert(queue.consume(), ==, 2);
+			assert(queue.consume(), ==, 1);
+		};
+
+		test_case("priorities above the highest level should use the highest level") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(2);
+			queue.produce(parallel_tools::priority{1}, 1);
+			queue.produce(parallel_tools::priority{10}, 2);
+
+			assert(queue.get_levels(), ==, 2u);
+			assert(queue.consume(), ==, 1);
+			assert(queue.consume(), ==, 2);
+		};
+
+		test_case("starving resources should be consumed before resources with higher priority") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(parallel_tools::queue_backend::priority_levels{2, 5ms});
+			queue.produce(parallel_tools::priority{0}, 1);
+			this_thread::sleep_for(10ms);
+			queue.produce(parallel_tools::priority{1}, 2);
+
+			assert(queue.consume(), ==, 1);
+			assert(queue.consume(), ==, 2);
+		};
+
+		test_case("consumption should report the end of the stream once all resources were consumed") {
+			parallel_tools::production_queue<int, parallel_tools::queue_backend::priority_levels> queue(2);
+			queue.produce(parallel_tools::priority{1}, 10);
+			queue.close();
+
+			assert(queue.produce(parallel_tools::priority{1}, 9), ==, false);
+			assert(queue.consume(), ==, 10);
+			bool end_reported = false;
+			try {
+				queue.consume();
+			} catch (const parallel_tools::queue_closed&) {
+				end_reported = true;
+			}
+
+			assert(end_reported, ==, true);
+			assert(queue.try_consume().has_value(), ==, false);
+		};
+	}
+} end_tests;
@@ -0,0 +1,100 @@
+#include <assertions-test/test.h>
+#include <segmented_queue.h>
+#include <memory>
+
+using namespace std;
+
+begin_tests {
+	test_suite("when pushing and popping resources") {
+		test_case("resources should be popped in the order they were pushed across many blocks") {
+			parallel_tools::segmented_queue<int> queue;
+			for (int i = 0; i < 10000; i++) {
+				queue.push(i);
+			}
+
+			assert(queue.size(), ==, 10000u);
+			bool ordered = true;
+			for (int i = 0; i < 10000; i++) {
+				if (queue.front() != i) {
+					ordered = false;
+				}
+				queue.pop();
+			}
+
+			assert(ordered, ==, true);
+			assert(queue.empty(), ==, true);
+		};
+
+		test_case("drained blocks should be kept for reuse") {
+			parallel_tools::segmented_queue<int> queue;
+			for (int i = 0; i < 10000; i++) {
+				queue.push(i);
+			}
+			while (!queue.empty()) {
+				queue.pop();
+			}
+			auto free_blocks = queue.get_free_blocks();
+
+			assert(free_blocks, >, 0u);
+
+			for (int i = 0; i < 10000; i++) {
+				queue.push(i);
+			}
+
+			assert(queue.get_free_blocks(), ==, 0u);
+		};
+
+		test_case("non trivial resources should be destroyed") {
+			auto resource = make_shared<int>(3);
+			{
+				parallel_tools::segmented_queue<shared_ptr<int>> queue;
+				queue.push(resource);
+				queue.push(resource);
+				queue.pop();
+
+				assert(resource.use_count(), ==, 2);
+			}
+
+			assert(resource.use_count(), ==, 1);
+		};
+	}
+
+	test_suite("when splicing queues") {
+		test_case("every resource of the other queue should be appended in order") {
+			parallel_tools::segmented_queue<int> queue;
+			parallel_tools::segmented_queue<int> other;
+			queue.push(1);
+			queue.push(2);
+			other.push(3);
+			other.push(4);
+
+			queue.splice(other);
+
+			assert(other.empty(), ==, true);
+			assert(queue.size(), ==, 4u);
+			for (int i = 1; i <= 4; i++) {
+				assert(queue.front(), ==, i);
+				queue.pop();
+			}
+		};
+
+		test_case("drained blocks should be handed to the other queue") {
+			parallel_tools::segmented_queue<int> consumers_queue;
+			parallel_tools::segmented_queue<int> producers_queue;
+			for (int i = 0; i < 10000; i++) {
+				producers_queue.push(i);
+			}
+			consumers_queue.splice(producers_queue);
+			while (!consumers_queue.empty()) {
+				consumers_queue.pop();
+			}
+			for (int i = 0; i < 10000; i++) {
+				producers_queue.push(i);
+			}
+
+			consumers_queue.splice(producers_queue);
+
+			assert(producers_queue.get_free_blocks(), >, 0u);
+		};
+	}
+} end_tests;
@@ -0,0 +1,186 @@
+#include <assertions-test/test.h>
+#include <strand.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when executing tasks in a strand") {
+		test_case("tasks should be executed in the order they were posted without overlapping") {
+			thread_pool pool(4);
+			strand serial(pool);
+			vector<int> order;
+			atomic<bool> running(false);
+			atomic<bool> overlapped(false);
+
+			for (int i = 0; i < 10000; i++) {
+				serial.post([&, i] {
+					if (running.exchange(true)) {
+						overlapped = true;
+					}
+					order.push_back(i);
+					running = false;
+				});
+			}
+			serial.exec([] {}).get();
+
+			bool ordered = order.size() == 10000;
+			for (int i = 0; ordered && i < 10000; i++) {
+				ordered = order[i] == i;
+			}
+			assert(ordered, ==, true);
+			assert(overlapped, ==, false);
+		};
+
+		test_case("exec should return the result of the task") {
+			thread_pool pool(2);
+			strand serial(pool);
+
+			auto future = serial.exec([](int a, int b) {
+				return a*b;
+			}, 3, 4);
+
+			assert(future.get(), ==, 12);
+		};
+
+		test_case("exceptions should be reported without stopping the strand") {
+			thread_pool pool(2);
+			strand serial(pool);
+			bool exception_reported = false;
+
+			auto failed = serial.exec([] {
+				throw runtime_error("failed");
+			});
+			auto next = serial.exec([] {
+				return 1;
+			});
+			try {
+				failed.get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+
+			assert(exception_reported, ==, true);
+			assert(next.get(), ==, 1);
+		};
+
+		test_case("exceptions thrown by posted tasks should reach the pool's exception handler") {
+			thread_pool pool(2);
+			strand serial(pool);
+			atomic<int> handled_exceptions(0);
+			pool.set_exception_handler([&](exception_ptr) {
+				handled_exceptions++;
+			});
+
+			serial.post([] {
+				throw runtime_error("failed");
+			});
+			auto next = serial.exec([] {
+				return 1;
+			});
+
+			assert(next.get(), ==, 1);
+			assert(handled_exceptions.load(), ==, 1);
+		};
+	}
+
+	test_suite("when executing tasks by key") {
+		test_case("tasks of the same key should be executed in order") {
+			thread_pool pool(4);
+			vector<vector<int>> orders(8);
+			{
+				keyed_executor<int> executor(pool);
+				for (int i = 0; i < 8000; i++) {
+					executor.post(i%8, [&, i] {
+						orders[i%8].push_back(i/8);
+					});
+				}
+			}
+
+			bool ordered = true;
+			for (auto& order : orders) {
+				ordered = ordered && order.size() == 1000;
+				for (size_t i = 0; ordered && i < order.size(); i++) {
+					ordered = order[i] == (int)i;
+				}
+			}
+			assert(ordered, ==, true);
+		};
+
+		test_case("tasks of different keys should be executed in parallel") {
+			thread_pool pool(2);
+			keyed_executor<string> executor(pool);
+			atomic<bool> second_key_executed(false);
+
+			auto first = executor.exec("first", [&] {
+				auto deadline = chrono::steady_clock::now() + 5s;
+				while (!second_key_executed && chrono::steady_clock::now() < deadline) {
+					this_thread::yield();
+				}
+				return second_key_executed.load();
+			});
+			executor.post("second", [&] {
+				second_key_executed = true;
+			});
+
+			assert(first.get(), ==, true);
+		};
+
+		test_case("keys without pending tasks should be released") {
+			thread_pool pool(2);
+			keyed_executor<int> executor(pool);
+
+			for (int i = 0; i < 100; i++) {
+				executor.exec(i, [] {}).get();
+			}
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (executor.get_active_keys() > 0 && chrono::steady_clock::now() < deadline) {
+				this_thread::yield();
+			}
+
+			assert(executor.get_active_keys(), ==, 0u);
+		};
+
+		test_case("destroying an executor should wait for its keys without running unrelated tasks") {
+			thread_pool pool(2);
+			promise<void> release;
+			pool.post([future = release.get_future().share()] {
+				future.wait();
+			});
+			mutex thread_ids_mutex;
+			vector<thread::id> unrelated_thread_ids;
+			atomic<bool> key_finished(false);
+
+			{
+				keyed_executor<int> executor(pool);
+				executor.post(0, [&] {
+					this_thread::sleep_for(20ms);
+					key_finished = true;
+				});
+				for (int i = 0; i < 10; i++) {
+					pool.post([&] {
+						lock_guard lock(thread_ids_mutex);
+						unrelated_thread_ids.push_back(this_thread::get_id());
+					});
+				}
+			}
+			bool finished_before_destruction = key_finished;
+			release.set_value();
+			pool.shutdown();
+
+			assert(finished_before_destruction, ==, true);
+			assert(unrelated_thread_ids.size(), ==, 10u);
+			for (auto& thread_id : unrelated_thread_ids) {
+				assert(thread_id, !=, this_thread::get_id());
+			}
+		};
+	}
+} end_tests;
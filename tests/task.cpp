@@ -0,0 +1,104 @@
+#include <assertions-test/test.h>
+#include <task.h>
+#include <array>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+begin_tests {
+	test_suite("when running a task") {
+		test_case("the wrapped function should be called") {
+			int calls = 0;
+			parallel_tools::task task([&] {
+				calls++;
+			});
+
+			task();
+			task();
+
+			assert(calls, ==, 2);
+		};
+
+		test_case("functions too large to be stored inline should be called") {
+			array<int, 64> values;
+			values.fill(1);
+			int sum = 0;
+			parallel_tools::task task([&sum, values] {
+				for (auto value : values) {
+					sum += value;
+				}
+			});
+
+			task();
+
+			assert(sum, ==, 64);
+		};
+
+		test_case("move only functions should be accepted") {
+			auto value = make_unique<int>(4);
+			int result = 0;
+			parallel_tools::task task([&result, value = std::move(value)] {
+				result = *value;
+			});
+
+			task();
+
+			assert(result, ==, 4);
+		};
+	}
+
+	test_suite("when moving a task") {
+		test_case("the moved task should be empty and the new task should call the function") {
+			int calls = 0;
+			parallel_tools::task task([&] {
+				calls++;
+			});
+			parallel_tools::task moved_task(std::move(task));
+
+			moved_task();
+
+			assert(calls, ==, 1);
+			assert(bool(task), ==, false);
+			assert(bool(moved_task), ==, true);
+		};
+
+		test_case("assigning a task should destroy the previous function") {
+			auto resource = make_shared<int>(0);
+			parallel_tools::task task([resource] {});
+			task = parallel_tools::task([] {});
+
+			assert(resource.use_count(), ==, 1);
+		};
+
+		test_case("the enqueue stamp should follow the task and cost nothing when not instrumented") {
+			parallel_tools::task task([] {});
+			task.set_enqueue_stamp({chrono::steady_clock::now(), 42});
+			parallel_tools::task moved_task(std::move(task));
+			parallel_tools::task assigned_task;
+			assigned_task = std::move(moved_task);
+
+			if constexpr (parallel_tools::metrics_enabled || parallel_tools::tracing_enabled) {
+				assert(assigned_task.get_enqueue_stamp().tick, ==, 42);
+			} else {
+				assert(assigned_task.get_enqueue_stamp().tick, ==, 0);
+				assert(sizeof(parallel_tools::task), ==, 64u);
+			}
+		};
+	}
+
+	test_suite("when destroying a task") {
+		test_case("captured resources should be released for inline and pooled functions") {
+			auto resource = make_shared<int>(0);
+			{
+				array<int, 64> values{};
+				parallel_tools::task inline_task([resource] {});
+				parallel_tools::task pooled_task([resource, values] {});
+
+				assert(resource.use_count(), ==, 3);
+			}
+
+			assert(resource.use_count(), ==, 1);
+		};
+	}
+} end_tests;
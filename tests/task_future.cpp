@@ -0,0 +1,245 @@
+#include <assertions-test/test.h>
+#include <task_future.h>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when executing tasks asynchronously") {
+		test_case("the future should hold the result of the task") {
+			thread_pool pool(2);
+
+			auto future = async(pool, [](int a, int b) {
+				return a + b;
+			}, 2, 4);
+
+			assert(future.get(), ==, 6);
+		};
+
+		test_case("the future should report the exception thrown by the task") {
+			thread_pool pool(2);
+			bool exception_reported = false;
+
+			auto future = async(pool, [] {
+				throw runtime_error("failed");
+			});
+			try {
+				future.get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+
+			assert(exception_reported, ==, true);
+		};
+
+		test_case("copies of a future should share the same result") {
+			thread_pool pool(2);
+
+			auto future = async(pool, [] {
+				return string("result");
+			});
+			auto copy = future;
+
+			assert(future.get(), ==, "result");
+			assert(copy.get(), ==, "result");
+		};
+
+		test_case("futures of tasks dropped by a shut down pool should report a broken promise") {
+			thread_pool pool(1);
+			auto ready = async(pool, [] {
+				return 1;
+			});
+			ready.get();
+			pool.shutdown();
+
+			auto dropped = async(pool, [] {
+				return 2;
+			});
+			auto dropped_continuation = dropped.then([](int value) {
+				return value + 1;
+			});
+			auto posted_continuation = ready.then([](int value) {
+				return value + 1;
+			});
+			auto is_broken_promise = [](auto& future) {
+				try {
+					future.get();
+				} catch (const future_error& error) {
+					return error.code() == future_errc::broken_promise;
+				}
+				return false;
+			};
+
+			assert(is_broken_promise(dropped), ==, true);
+			assert(is_broken_promise(dropped_continuation), ==, true);
+			assert(is_broken_promise(posted_continuation), ==, true);
+		};
+	}
+
+	test_suite("when chaining continuations") {
+		test_case("continuations should receive the result of the previous task") {
+			thread_pool pool(2);
+
+			auto future = async(pool, [] {
+				return 2;
+			}).then([](int value) {
+				return value*3;
+			}).then([](int value) {
+				return to_string(value);
+			});
+
+			assert(future.get(), ==, "6");
+		};
+
+		test_case("continuations of void tasks should take no arguments") {
+			thread_pool pool(2);
+			atomic<int> executed_tasks(0);
+
+			auto future = async(pool, [&] {
+				executed_tasks++;
+			}).then([&] {
+				executed_tasks++;
+				return 1;
+			});
+
+			assert(future.get(), ==, 1);
+			assert(executed_tasks, ==, 2);
+		};
+
+		test_case("continuations added to a ready future should still be executed") {
+			thread_pool pool(2);
+			auto future = async(pool, [] {
+				return 5;
+			});
+			future.wait();
+
+			auto continuation = future.then([](int value) {
+				return value + 1;
+			});
+
+			assert(continuation.get(), ==, 6);
+		};
+
+		test_case("exceptions should skip continuations and propagate through the chain") {
+			thread_pool pool(2);
+			atomic<bool> continuation_executed(false);
+			bool exception_reported = false;
+
+			auto future = async(pool, []() -> int {
+				throw runtime_error("failed");
+			}).then([&](int value) {
+				continuation_executed = true;
+				return value;
+			});
+			try {
+				future.get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+
+			assert(exception_reported, ==, true);
+			assert(continuation_executed, ==, false);
+		};
+
+		test_case("long chains of continuations should not need more than one thread") {
+			thread_pool pool(1);
+
+			auto first = async(pool, [] {
+				return 1;
+			});
+			for (int i = 0; i < 100; i++) {
+				first = first.then([](int value) {
+					return value + 1;
+				});
+			}
+
+			assert(first.get(), ==, 101);
+		};
+	}
+
+	test_suite("when combining futures") {
+		test_case("when_all should be ready once every future is ready") {
+			thread_pool pool(4);
+			vector<task_future<int>> futures;
+			for (int i = 0; i < 100; i++) {
+				futures.push_back(async(pool, [i] {
+					return i;
+				}));
+			}
+
+			auto all = when_all(futures).then([](const vector<task_future<int>>& futures) {
+				int sum = 0;
+				for (auto& future : futures) {
+					sum += future.get();
+				}
+				return sum;
+			});
+
+			assert(all.get(), ==, 4950);
+		};
+
+		test_case("when_all should combine futures of different types") {
+			thread_pool pool(2);
+			auto number = async(pool, [] {
+				return 3;
+			});
+			auto text = async(pool, [] {
+				return string("three");
+			});
+			auto nothing = async(pool, [] {});
+
+			auto all = when_all(number, text, nothing);
+			auto& futures = all.get();
+
+			assert(get<0>(futures).get(), ==, 3);
+			assert(get<1>(futures).get(), ==, "three");
+		};
+
+		test_case("when_all of no futures should be ready immediately") {
+			auto all = when_all(vector<task_future<int>>());
+
+			assert(all.is_ready(), ==, true);
+		};
+
+		test_case("when_any should report the first future to become ready") {
+			thread_pool pool(2);
+			promise<void> release;
+			auto released = release.get_future().share();
+			vector<task_future<int>> futures;
+			futures.push_back(async(pool, [released] {
+				released.wait();
+				return 0;
+			}));
+			futures.push_back(async(pool, [] {
+				return 1;
+			}));
+
+			auto any = when_any(futures);
+			auto index = any.get().index;
+			release.set_value();
+
+			assert(index, ==, 1u);
+		};
+	}
+
+	test_suite("when getting results inside worker threads") {
+		test_case("workers getting nested results should execute other tasks instead of blocking") {
+			thread_pool pool(1);
+
+			auto result = async(pool, [&] {
+				auto nested = async(pool, [] {
+					return 4;
+				});
+				return nested.get()*2;
+			});
+
+			assert(result.get(), ==, 8);
+		};
+	}
+} end_tests;
@@ -0,0 +1,140 @@
+#include <assertions-test/test.h>
+#include <task_graph.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace parallel_tools;
+using namespace std;
+
+begin_tests {
+	test_suite("when running task graphs") {
+		test_case("every node should be executed after its dependencies") {
+			thread_pool pool(4);
+			mutex order_mutex;
+			vector<int> order;
+			auto record = [&](int node) {
+				return [&, node] {
+					lock_guard lock(order_mutex);
+					order.push_back(node);
+				};
+			};
+
+			task_graph graph;
+			auto load = graph.add(record(0));
+			auto parse = graph.add(record(1), {load});
+			auto validate = graph.add(record(2), {load});
+			graph.add(record(3), {parse, validate});
+			graph.run(pool).get();
+
+			assert(order.size(), ==, 4u);
+			assert(order.front(), ==, 0);
+			assert(order.back(), ==, 3);
+		};
+
+		test_case("independent nodes should all be executed") {
+			thread_pool pool(4);
+			atomic<int> executed_nodes(0);
+			task_graph graph;
+			auto root = graph.add([] {});
+			for (int i = 0; i < 1000; i++) {
+				graph.add([&] {
+					executed_nodes++;
+				}, {root});
+			}
+
+			graph.run(pool).get();
+
+			assert(executed_nodes, ==, 1000);
+		};
+
+		test_case("graphs should be reusable") {
+			thread_pool pool(2);
+			atomic<int> executed_nodes(0);
+			task_graph graph;
+			auto first = graph.add([&] {
+				executed_nodes++;
+			});
+			auto second = graph.add([&] {
+				executed_nodes++;
+			});
+			graph.precede(first, second);
+
+			graph.run(pool).get();
+			graph.run(pool).get();
+
+			assert(executed_nodes, ==, 4);
+		};
+
+		test_case("an exception should skip the remaining nodes and be reported") {
+			thread_pool pool(2);
+			atomic<bool> successor_executed(false);
+			bool exception_reported = false;
+			task_graph graph;
+			auto failing = graph.add([] {
+				throw runtime_error("failed");
+			});
+			graph.add([&] {
+				successor_executed = true;
+			}, {failing});
+
+			try {
+				graph.run(pool).get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+
+			assert(exception_reported, ==, true);
+			assert(successor_executed, ==, false);
+		};
+
+		test_case("graphs with cycles should be rejected") {
+			thread_pool pool(2);
+			bool cycle_detected = false;
+			task_graph graph;
+			auto first = graph.add([] {});
+			auto second = graph.add([] {}, {first});
+			graph.precede(second, first);
+
+			try {
+				graph.run(pool);
+			} catch (const task_graph_cycle&) {
+				cycle_detected = true;
+			}
+
+			assert(cycle_detected, ==, true);
+		};
+
+		test_case("empty graphs should be ready immediately") {
+			thread_pool pool(2);
+			task_graph graph;
+
+			assert(graph.run(pool).is_ready(), ==, true);
+		};
+
+		test_case("graphs run on a shut down pool should report a broken promise") {
+			thread_pool pool(1);
+			task_graph graph;
+			atomic<bool> executed(false);
+			auto first = graph.add([&] {
+				executed = true;
+			});
+			graph.add([&] {
+				executed = true;
+			}, {first});
+			pool.shutdown();
+
+			bool broken_promise = false;
+			try {
+				graph.run(pool).get();
+			} catch (const future_error& error) {
+				broken_promise = error.code() == future_errc::broken_promise;
+			}
+
+			assert(broken_promise, ==, true);
+			assert(executed, ==, false);
+		};
+	}
+} end_tests;
@@ -1,5 +1,6 @@
 #include <assertions-test/test.h>
 #include <thread_pool.h>
+#include <sstream>
 #include <stopwatch/stopwatch.h>
 
 using namespace parallel_tools;
@@ -349,5 +350,960 @@ begin_tests {
 			assert(stopwatch.lap_time(), <, 300ms);
 		};
 	}
-} end_tests;
 
+	test_suite("when using a thread pool with a ring buffer task queue") {
+		test_case("pool should process functions with arguments and return") {
+			thread_pool pool(2, queue_backend::ring_buffer{64});
+
+			auto subtractionFuture = pool.exec([](int arg1, int arg2) {
+				return arg1 - arg2;
+			}, 10, 2);
+			auto sumFuture = pool.exec([](int arg1, int arg2) {
+				return arg1 + arg2;
+			}, 5, 2);
+
+			assert(subtractionFuture.get(), ==, 8);
+			assert(sumFuture.get(), ==, 7);
+		};
+
+		test_case("pool should execute 100,000 tasks in less than 300ms") {
+			const int tasks_to_execute = 100'000;
+			thread_pool pool(2, queue_backend::ring_buffer{1024});
+			vector<future<void>> futures;
+			futures.reserve(tasks_to_execute);
+
+			stopwatch stopwatch;
+			for (int i = 0; i < tasks_to_execute; i++) {
+				futures.emplace_back(pool.exec([]{}));
+			}
+
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(stopwatch.lap_time(), <, 300ms);
+		};
+	}
+
+	test_suite("when shutting down a thread pool") {
+		test_case("shutdown should execute all queued tasks before returning") {
+			thread_pool pool(2);
+			atomic<int> executed_tasks(0);
+
+			for (int i = 0; i < 1000; i++) {
+				pool.exec([&] {
+					executed_tasks++;
+				});
+			}
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 1000);
+			assert(pool.is_running(), ==, false);
+		};
+
+		test_case("shutdown should not deadlock when using a batch flush policy") {
+			thread_pool pool(2, flush_policy::batches_of{4});
+			atomic<int> executed_tasks(0);
+
+			for (int i = 0; i < 3; i++) {
+				pool.exec([&] {
+					executed_tasks++;
+				});
+			}
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 3);
+		};
+
+		test_case("shutdown now should drop tasks which have not been consumed from the queue") {
+			thread_pool pool(1);
+			atomic<int> executed_tasks(0);
+
+			pool.exec([] {
+				this_thread::sleep_for(15ms);
+			});
+			this_thread::sleep_for(5ms);
+			auto dropped_future = pool.exec([&] {
+				executed_tasks++;
+			});
+			pool.shutdown_now();
+
+			bool broken_promise = false;
+			try {
+				dropped_future.get();
+			} catch (const future_error&) {
+				broken_promise = true;
+			}
+
+			assert(executed_tasks, ==, 0);
+			assert(broken_promise, ==, true);
+		};
+
+		test_case("shutdown should execute all queued tasks of a ring buffer task queue") {
+			thread_pool pool(2, queue_backend::ring_buffer{16});
+			atomic<int> executed_tasks(0);
+
+			for (int i = 0; i < 1000; i++) {
+				pool.exec([&] {
+					executed_tasks++;
+				});
+			}
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 1000);
+		};
+	}
+	test_suite("when using a wait strategy") {
+		auto run_tasks = [](thread_pool& pool) {
+			atomic<int> executed_tasks(0);
+			vector<future<void>> futures;
+			for (int i = 0; i < 1000; i++) {
+				futures.push_back(pool.exec([&] {
+					executed_tasks++;
+				}));
+			}
+			for (auto& future : futures) {
+				future.wait();
+			}
+			return executed_tasks.load();
+		};
+
+		test_case("a spinning then yielding pool should execute every task") {
+			thread_pool pool(2, wait_strategy::spin_then_yield{});
+			assert(run_tasks(pool), ==, 1000);
+		};
+
+		test_case("a blocking pool should execute every task") {
+			thread_pool pool(2, wait_strategy::blocking{});
+			assert(run_tasks(pool), ==, 1000);
+		};
+
+		test_case("a spinning then parking ring buffer pool should execute every task") {
+			thread_pool pool(2, queue_backend::ring_buffer{16}, wait_strategy::spin_then_park{});
+			assert(run_tasks(pool), ==, 1000);
+		};
+
+		test_case("a blocking pool should shut down while its threads are parked") {
+			thread_pool pool(2, flush_policy::batches_of{1}, wait_strategy::blocking{});
+			this_thread::sleep_for(5ms);
+			pool.shutdown();
+			assert(pool.is_running(), ==, false);
+		};
+	}
+
+	test_suite("when using sharded producer buffers") {
+		test_case("tasks submitted from many threads should all be executed") {
+			thread_pool pool(2, queue_backend::double_buffer{4});
+			atomic<int> executed_tasks(0);
+
+			vector<thread> submitters;
+			for (int i = 0; i < 4; i++) {
+				submitters.emplace_back([&] {
+					for (int j = 0; j < 250; j++) {
+						pool.exec([&] {
+							executed_tasks++;
+						});
+					}
+				});
+			}
+			for (auto& submitter : submitters) {
+				submitter.join();
+			}
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 1000);
+		};
+	}
+
+	test_suite("when using time based and adaptive flush policies") {
+		test_case("a single task should be executed with a maximum latency policy") {
+			thread_pool pool(2, flush_policy::max_latency{1ms});
+
+			auto future = pool.exec([] {
+				return 5;
+			});
+
+			assert(future.wait_for(500ms) == future_status::ready, ==, true);
+			assert(future.get(), ==, 5);
+		};
+
+		test_case("every task should be executed with an adaptive policy") {
+			thread_pool pool(2, flush_policy::adaptive{1, 64, 1ms});
+			atomic<int> executed_tasks(0);
+
+			vector<future<void>> futures;
+			for (int i = 0; i < 1000; i++) {
+				futures.push_back(pool.exec([&] {
+					executed_tasks++;
+				}));
+			}
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(executed_tasks, ==, 1000);
+		};
+	}
+
+	test_suite("when executing tasks with priorities") {
+		test_case("tasks with higher priority should be executed first") {
+			thread_pool pool(1, queue_backend::priority_levels{2});
+			vector<int> execution_order;
+
+			pool.exec([] {
+				this_thread::sleep_for(15ms);
+			});
+			this_thread::sleep_for(5ms);
+			for (int i = 0; i < 3; i++) {
+				pool.exec(priority{0}, [&, i] {
+					execution_order.push_back(i);
+				});
+			}
+			pool.exec(priority{1}, [&] {
+				execution_order.push_back(10);
+			});
+			pool.shutdown();
+
+			assert(execution_order.size(), ==, 4u);
+			assert(execution_order[0], ==, 10);
+			assert(execution_order[1], ==, 0);
+			assert(execution_order[3], ==, 2);
+		};
+
+		test_case("priorities should be ignored by pools without a priority backend") {
+			thread_pool pool(2);
+
+			auto future = pool.exec(priority{3}, [](int a, int b) {
+				return a + b;
+			}, 2, 4);
+
+			assert(future.get(), ==, 6);
+		};
+	}
+
+	test_suite("when using work stealing") {
+		test_case("every task should be executed") {
+			thread_pool pool(4, work_stealing{});
+			atomic<int> executed_tasks(0);
+
+			vector<future<void>> futures;
+			for (int i = 0; i < 1000; i++) {
+				futures.push_back(pool.exec([&] {
+					executed_tasks++;
+				}));
+			}
+			for (auto& future : futures) {
+				future.wait();
+			}
+
+			assert(executed_tasks, ==, 1000);
+		};
+
+		test_case("tasks spawned from inside tasks should all be executed") {
+			thread_pool pool(4, work_stealing{});
+			atomic<int> executed_tasks(0);
+
+			function<void(int)> split = [&](int depth) {
+				executed_tasks++;
+				if (depth > 0) {
+					pool.exec(split, depth - 1);
+					pool.exec(split, depth - 1);
+				}
+			};
+			pool.exec(split, 10);
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 2047);
+		};
+
+		test_case("shutdown now should drop tasks waiting in local queues") {
+			thread_pool pool(1, work_stealing{});
+			atomic<int> executed_tasks(0);
+			promise<future<void>> nested_future;
+
+			pool.exec([&] {
+				nested_future.set_value(pool.exec([&] {
+					executed_tasks++;
+				}));
+				this_thread::sleep_for(15ms);
+			});
+			auto dropped_future = nested_future.get_future().get();
+			pool.shutdown_now();
+
+			bool broken_promise = false;
+			try {
+				dropped_future.get();
+			} catch (const future_error&) {
+				broken_promise = true;
+			}
+
+			assert(executed_tasks, ==, 0);
+			assert(broken_promise, ==, true);
+		};
+	}
+
+	test_suite("when passing arguments to tasks") {
+		test_case("move only arguments should be forwarded") {
+			thread_pool pool(2);
+
+			auto future = pool.exec([](unique_ptr<int> value) {
+				return *value;
+			}, make_unique<int>(7));
+
+			assert(future.get(), ==, 7);
+		};
+
+		test_case("arguments wrapped in references should not be copied") {
+			thread_pool pool(2);
+			int value = 0;
+
+			pool.exec([](int& reference) {
+				reference = 3;
+			}, ref(value)).wait();
+
+			assert(value, ==, 3);
+		};
+
+		test_case("exceptions thrown by tasks should be reported through their futures") {
+			thread_pool pool(2);
+
+			auto future = pool.exec([] {
+				throw runtime_error("failed");
+			});
+
+			bool exception_reported = false;
+			try {
+				future.get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+			assert(exception_reported, ==, true);
+		};
+	}
+
+	test_suite("when posting tasks without futures") {
+		test_case("every posted task should be executed") {
+			thread_pool pool(2);
+			atomic<int> sum(0);
+
+			for (int i = 1; i <= 100; i++) {
+				pool.post([&](int value) {
+					sum += value;
+				}, i);
+			}
+			pool.shutdown();
+
+			assert(sum, ==, 5050);
+		};
+
+		test_case("posted tasks with priorities should be executed") {
+			thread_pool pool(1, queue_backend::priority_levels{2});
+			atomic<int> executed_tasks(0);
+
+			pool.post(priority{1}, [&] {
+				executed_tasks++;
+			});
+			pool.post(priority{0}, [&] {
+				executed_tasks++;
+			});
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 2);
+		};
+
+		test_case("exceptions thrown by posted tasks should not stop the pool") {
+			thread_pool pool(1);
+
+			pool.post([] {
+				throw runtime_error("failed");
+			});
+			auto future = pool.exec([] {
+				return 3;
+			});
+
+			assert(future.get(), ==, 3);
+		};
+
+		test_case("exceptions thrown by posted tasks and timers should be passed to the exception handler") {
+			thread_pool pool(2);
+			atomic<int> handled_exceptions(0);
+			pool.set_exception_handler([&](exception_ptr exception) {
+				try {
+					rethrow_exception(exception);
+				} catch (const runtime_error&) {
+					handled_exceptions++;
+				}
+			});
+
+			pool.post([] {
+				throw runtime_error("failed");
+			});
+			auto timer = pool.exec_every(1ms, [] {
+				throw runtime_error("failed");
+			});
+			for (int i = 0; i < 1000 && handled_exceptions < 3; i++) {
+				this_thread::sleep_for(1ms);
+			}
+			timer.cancel();
+
+			assert(handled_exceptions.load(), >=, 3);
+		};
+	}
+
+	test_suite("when submitting tasks in bulk") {
+		test_case("every task posted in bulk should be executed") {
+			thread_pool pool(2);
+			atomic<int> executed_tasks(0);
+			vector<function<void()>> tasks(1000, [&] {
+				executed_tasks++;
+			});
+
+			pool.post_bulk(tasks);
+			pool.shutdown();
+
+			assert(executed_tasks, ==, 1000);
+		};
+
+		test_case("the group future should be ready once every task was executed") {
+			thread_pool pool(2);
+			atomic<int> executed_tasks(0);
+			vector<function<void()>> tasks(1000, [&] {
+				executed_tasks++;
+			});
+
+			auto future = pool.exec_bulk(std::move(tasks));
+			future.get();
+
+			assert(executed_tasks, ==, 1000);
+		};
+
+		test_case("the group future should report the exception of a failed task") {
+			thread_pool pool(2);
+			atomic<int> executed_tasks(0);
+			vector<function<void()>> tasks(10, [&] {
+				executed_tasks++;
+			});
+			tasks[5] = [] {
+				throw runtime_error("failed");
+			};
+
+			auto future = pool.exec_bulk(tasks.begin(), tasks.end());
+			bool exception_reported = false;
+			try {
+				future.get();
+			} catch (const runtime_error&) {
+				exception_reported = true;
+			}
+
+			assert(exception_reported, ==, true);
+			assert(executed_tasks, ==, 9);
+		};
+
+		test_case("the group future of an empty group should be ready immediately") {
+			thread_pool pool(2);
+			vector<function<void()>> tasks;
+
+			auto future = pool.exec_bulk(tasks);
+
+			assert(future.wait_for(0ms) == future_status::ready, ==, true);
+		};
+
+		test_case("tasks submitted in bulk from inside a work stealing pool should be executed") {
+			thread_pool pool(4, work_stealing{});
+			atomic<int> executed_tasks(0);
+
+			auto future = pool.exec([&] {
+				vector<function<void()>> tasks(100, [&] {
+					executed_tasks++;
+				});
+				return pool.exec_bulk(std::move(tasks));
+			});
+			future.get().get();
+
+			assert(executed_tasks, ==, 100);
+		};
+	}
+
+	test_suite("when resizing thread pools") {
+		test_case("growing the pool should allow more tasks to execute at the same time") {
+			thread_pool pool(1);
+			atomic<int> running_tasks(0);
+
+			pool.resize(4);
+			vector<future<void>> futures;
+			for (int i = 0; i < 4; i++) {
+				futures.push_back(pool.exec([&] {
+					running_tasks++;
+					while (running_tasks < 4) {
+						this_thread::yield();
+					}
+				}));
+			}
+			for (auto& future : futures) {
+				future.get();
+			}
+
+			assert(pool.get_number_of_threads(), ==, 4u);
+		};
+
+		test_case("shrinking the pool should retire threads and keep executing tasks") {
+			thread_pool pool(4);
+
+			pool.resize(1);
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (pool.get_number_of_threads() > 1 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			auto future = pool.exec([] {
+				return 3;
+			});
+
+			assert(pool.get_number_of_threads(), ==, 1u);
+			assert(future.get(), ==, 3);
+		};
+
+		test_case("shrinking a pool with a bounded queue should not take room from tasks") {
+			thread_pool pool(4, queue_backend::ring_buffer{2});
+
+			pool.resize(1);
+			auto first = pool.exec([] {
+				return 1;
+			});
+			auto second = pool.exec([] {
+				return 2;
+			});
+
+			assert(first.get() + second.get(), ==, 3);
+		};
+
+		test_case("resizing a work stealing pool should be rejected") {
+			thread_pool pool(2, work_stealing{});
+			bool rejected = false;
+
+			try {
+				pool.resize(4);
+			} catch (const logic_error&) {
+				rejected = true;
+			}
+
+			assert(rejected, ==, true);
+			assert(pool.get_number_of_threads(), ==, 2u);
+		};
+	}
+
+	test_suite("when using elastic thread pools") {
+		test_case("the pool should start with the minimum number of threads") {
+			thread_pool pool(elastic{2, 8});
+
+			assert(pool.get_number_of_threads(), ==, 2u);
+		};
+
+		test_case("the pool should grow while tasks are queued and shrink back when idle") {
+			thread_pool pool(elastic{1, 4, 0, 20ms});
+			atomic<bool> released(false);
+			atomic<int> running_tasks(0);
+
+			vector<future<void>> futures;
+			for (int i = 0; i < 4; i++) {
+				futures.push_back(pool.exec([&] {
+					running_tasks++;
+					while (!released) {
+						this_thread::yield();
+					}
+				}));
+			}
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (running_tasks < 4 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			auto grown_threads = pool.get_number_of_threads();
+			released = true;
+			for (auto& future : futures) {
+				future.get();
+			}
+			deadline = chrono::steady_clock::now() + 5s;
+			while (pool.get_number_of_threads() > 1 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+
+			assert(grown_threads, ==, 4u);
+			assert(running_tasks, ==, 4);
+			assert(pool.get_number_of_threads(), ==, 1u);
+		};
+
+		test_case("the pool should not grow beyond the maximum number of threads") {
+			thread_pool pool(elastic{1, 2, 0});
+			atomic<int> executed_tasks(0);
+
+			for (int i = 0; i < 1000; i++) {
+				pool.post([&] {
+					executed_tasks++;
+				});
+			}
+			auto threads = pool.get_number_of_threads();
+			pool.shutdown();
+
+			assert(threads, <=, 2u);
+			assert(executed_tasks, ==, 1000);
+		};
+	}
+
+	test_suite("when waiting for futures inside worker threads") {
+		test_case("workers waiting for nested tasks should not deadlock shared queue or work stealing pools") {
+			vector<thread_pool_options> configurations(2);
+			configurations[1].queue = work_stealing{};
+
+			for (auto& options : configurations) {
+				thread_pool pool(2, options);
+				function<int(int)> sum_recursively = [&](int depth) {
+					if (depth == 0) {
+						return 1;
+					}
+					auto left = pool.exec(sum_recursively, depth - 1);
+					auto right = pool.exec(sum_recursively, depth - 1);
+					pool.wait(left);
+					pool.wait(right);
+					return left.get() + right.get();
+				};
+
+				auto result = pool.exec(sum_recursively, 10);
+
+				assert(result.get(), ==, 1024);
+			}
+		};
+
+		test_case("helping threads should park instead of spinning while nothing is queued") {
+			thread_pool pool(1);
+			atomic<bool> released(false);
+			atomic<int> predicate_checks(0);
+
+			auto future = pool.exec([&] {
+				pool.help_until([&] {
+					predicate_checks++;
+					return released.load();
+				});
+			});
+			this_thread::sleep_for(50ms);
+			auto checks_while_idle = predicate_checks.load();
+			released = true;
+			future.get();
+
+			assert(checks_while_idle, <, 2000);
+		};
+
+		test_case("a single worker should execute the awaited task itself") {
+			thread_pool pool(1);
+
+			auto result = pool.exec([&] {
+				auto nested = pool.exec([] {
+					return 5;
+				});
+				pool.wait(nested);
+				return nested.get();
+			});
+
+			assert(result.get(), ==, 5);
+		};
+
+		test_case("threads outside the pool should simply block") {
+			thread_pool pool(1);
+			auto future = pool.exec([] {
+				return 3;
+			});
+
+			pool.wait(future);
+
+			assert(pool.is_worker_thread(), ==, false);
+			assert(future.get(), ==, 3);
+		};
+	}
+
+	test_suite("when executing tasks with timers") {
+		test_case("tasks executed after a delay should not be executed before the delay") {
+			thread_pool pool(2);
+			promise<chrono::steady_clock::time_point> executed;
+			auto execution_time = executed.get_future();
+			auto scheduling_time = chrono::steady_clock::now();
+
+			pool.exec_after(20ms, [&] {
+				executed.set_value(chrono::steady_clock::now());
+			});
+
+			assert(execution_time.get() - scheduling_time, >=, 20ms);
+		};
+
+		test_case("tasks executed at a time point should receive their arguments") {
+			thread_pool pool(2);
+			promise<int> executed;
+			auto result = executed.get_future();
+
+			pool.exec_at(chrono::system_clock::now() + 5ms, [&](int a, int b) {
+				executed.set_value(a + b);
+			}, 2, 3);
+
+			assert(result.get(), ==, 5);
+		};
+
+		test_case("periodic tasks should be executed repeatedly until cancelled") {
+			thread_pool pool(2);
+			atomic<int> executions(0);
+
+			auto handle = pool.exec_every(2ms, [&] {
+				executions++;
+			});
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (executions < 3 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			handle.cancel();
+
+			assert(executions, >=, 3);
+		};
+
+		test_case("cancelled delayed tasks should not be executed") {
+			thread_pool pool(2);
+			atomic<bool> executed(false);
+
+			auto handle = pool.exec_after(10ms, [&] {
+				executed = true;
+			});
+			handle.cancel();
+			this_thread::sleep_for(30ms);
+
+			assert(executed, ==, false);
+		};
+
+		test_case("shutting down the pool should drop pending timers") {
+			atomic<bool> executed(false);
+			{
+				thread_pool pool(1);
+				pool.exec_after(1h, [&] {
+					executed = true;
+				});
+				pool.shutdown();
+			}
+
+			assert(executed, ==, false);
+		};
+	}
+
+	test_suite("when executing tasks with cancellation tokens") {
+		test_case("cancelled tasks should not be executed and their futures should report the cancellation") {
+			thread_pool pool(1);
+			promise<void> release;
+			auto blocker = pool.exec([future = release.get_future().share()] {
+				future.wait();
+			});
+			cancellation_source source;
+			atomic<bool> executed(false);
+
+			auto future = pool.exec(source.get_token(), [&] {
+				executed = true;
+				return 10;
+			});
+			source.cancel();
+			release.set_value();
+			bool cancelled = false;
+			try {
+				future.get();
+			} catch (const task_cancelled&) {
+				cancelled = true;
+			}
+
+			assert(cancelled, ==, true);
+			assert(executed, ==, false);
+		};
+
+		test_case("tasks past their deadline should report deadline_exceeded") {
+			thread_pool pool(1);
+			auto blocker = pool.exec([] {
+				this_thread::sleep_for(20ms);
+			});
+			atomic<bool> executed(false);
+
+			auto future = pool.exec(cancellation_token().with_timeout(5ms), [&] {
+				executed = true;
+			});
+			bool expired = false;
+			try {
+				future.get();
+			} catch (const deadline_exceeded&) {
+				expired = true;
+			}
+
+			assert(expired, ==, true);
+			assert(executed, ==, false);
+		};
+
+		test_case("tasks should execute normally when their token is not cancelled") {
+			thread_pool pool(2);
+			cancellation_source source;
+
+			auto future = pool.exec(source.get_token(), [](int a, int b) {
+				return a*b;
+			}, 6, 7);
+
+			assert(future.get(), ==, 42);
+		};
+
+		test_case("running tasks should be able to poll their token") {
+			thread_pool pool(2);
+			cancellation_source source;
+			auto token = source.get_token();
+			atomic<bool> started(false);
+
+			auto future = pool.exec(token, [&started, token] {
+				started = true;
+				while (true) {
+					token.throw_if_stop_requested();
+					this_thread::yield();
+				}
+			});
+			while (!started) {
+				this_thread::yield();
+			}
+			source.cancel();
+			bool cancelled = false;
+			try {
+				future.get();
+			} catch (const task_cancelled&) {
+				cancelled = true;
+			}
+
+			assert(cancelled, ==, true);
+		};
+
+		test_case("a cancelled group should skip every posted and bulk task") {
+			thread_pool pool(1);
+			promise<void> release;
+			auto blocker = pool.exec([future = release.get_future().share()] {
+				future.wait();
+			});
+			cancellation_source source;
+			atomic<int> executions(0);
+			vector<function<void()>> tasks(10, [&] {
+				executions++;
+			});
+
+			for (int i = 0; i < 10; i++) {
+				pool.post(source.get_token(), [&] {
+					executions++;
+				});
+			}
+			auto group = pool.exec_bulk(source.get_token(), tasks);
+			source.cancel();
+			release.set_value();
+			bool cancelled = false;
+			try {
+				group.get();
+			} catch (const task_cancelled&) {
+				cancelled = true;
+			}
+			pool.shutdown();
+
+			assert(cancelled, ==, true);
+			assert(executions, ==, 0);
+		};
+
+		test_case("prioritized tasks should honour their token") {
+			thread_pool pool(1, queue_backend::priority_levels{2});
+			promise<void> release;
+			auto blocker = pool.exec([future = release.get_future().share()] {
+				future.wait();
+			});
+			cancellation_source source;
+			auto token = source.get_token();
+			atomic<int> executions(0);
+
+			auto cancelled_future = pool.exec(priority{1}, token, [&] {
+				executions++;
+			});
+			pool.post(priority{1}, token, [&] {
+				executions++;
+			});
+			auto future = pool.exec(priority{0}, cancellation_token(), [](int a, int b) {
+				return a + b;
+			}, 2, 3);
+			source.cancel();
+			release.set_value();
+			bool cancelled = false;
+			try {
+				cancelled_future.get();
+			} catch (const task_cancelled&) {
+				cancelled = true;
+			}
+
+			assert(cancelled, ==, true);
+			assert(future.get(), ==, 5);
+			assert(executions, ==, 0);
+		};
+	}
+
+	test_suite("when reading the metrics of a pool") {
+		test_case("metrics should only be collected when enabled at compile time") {
+			thread_pool pool(2);
+			vector<future<void>> futures;
+
+			for (int i = 0; i < 100; i++) {
+				futures.push_back(pool.exec([] {
+					this_thread::sleep_for(10us);
+				}));
+			}
+			for (auto& future : futures) {
+				future.get();
+			}
+			pool.shutdown();
+			auto metrics = pool.get_metrics();
+
+			if constexpr (metrics_enabled) {
+				uint64_t executed_tasks = 0;
+				for (auto& worker : metrics.workers) {
+					executed_tasks += worker.executed_tasks;
+				}
+				assert(metrics.run_time.count, ==, 100u);
+				assert(metrics.queueing_delay.count, ==, 100u);
+				assert(metrics.run_time.percentile(50), >=, 10000u);
+				assert(metrics.workers.size(), ==, 2u);
+				assert(executed_tasks, ==, 100u);
+				assert(metrics.queue.swaps, >, 0u);
+				assert(metrics.queue.consumer_wait.count, >, 0u);
+			} else {
+				assert(metrics.run_time.count, ==, 0u);
+				assert(metrics.workers.empty(), ==, true);
+				assert(metrics.queue.swaps, ==, 0u);
+			}
+		};
+	}
+
+	test_suite("when tracing a pool") {
+		test_case("traces should only contain tasks when tracing is enabled at compile time") {
+			thread_pool pool(2);
+			vector<future<void>> futures;
+
+			for (int i = 0; i < 20; i++) {
+				futures.push_back(pool.exec([] {
+					this_thread::sleep_for(100us);
+				}));
+			}
+			for (auto& future : futures) {
+				future.get();
+			}
+			pool.shutdown();
+			stringstream output;
+			pool.write_trace(output);
+			auto trace = output.str();
+
+			assert(trace.find("\"traceEvents\":["), !=, string::npos);
+			if constexpr (tracing_enabled) {
+				size_t traced_tasks = 0;
+				for (auto position = trace.find("\"name\":\"task\""); position != string::npos; position = trace.find("\"name\":\"task\"", position + 1)) {
+					traced_tasks++;
+				}
+				assert(traced_tasks, ==, 20u);
+				assert(trace.find("worker-1"), !=, string::npos);
+			} else {
+				assert(trace.find("\"name\":\"task\""), ==, string::npos);
+			}
+		};
+	}
+} end_tests;
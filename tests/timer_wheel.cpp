@@ -0,0 +1,202 @@
+#include <assertions-test/test.h>
+#include <timer_wheel.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace parallel_tools;
+using namespace std;
+
+namespace {
+	class recorded_timers {
+		private:
+			mutex records_mutex;
+			vector<pair<int, chrono::steady_clock::time_point>> records;
+
+		public:
+			void record(int timer) {
+				lock_guard lock(records_mutex);
+				records.emplace_back(timer, chrono::steady_clock::now());
+			}
+
+			vector<pair<int, chrono::steady_clock::time_point>> get_records() {
+				lock_guard lock(records_mutex);
+				return records;
+			}
+
+			bool wait_for_records(size_t number_of_records) {
+				auto deadline = chrono::steady_clock::now() + 5s;
+				while (get_records().size() < number_of_records && chrono::steady_clock::now() < deadline) {
+					this_thread::sleep_for(1ms);
+				}
+				return get_records().size() >= number_of_records;
+			}
+	};
+
+	void execute_inline(vector<task>&& expired_tasks) {
+		for (auto& expired_task : expired_tasks) {
+			expired_task();
+		}
+	}
+}
+
+begin_tests {
+	test_suite("when scheduling timers") {
+		test_case("timers should expire in the order of their deadlines and never early") {
+			timer_wheel timers(execute_inline);
+			recorded_timers records;
+			auto now = chrono::steady_clock::now();
+			vector<chrono::steady_clock::time_point> deadlines = {now + 30ms, now + 10ms, now + 20ms};
+
+			for (int i = 0; i < 3; i++) {
+				timers.schedule(deadlines[i], chrono::steady_clock::duration::zero(), task([&, i] {
+					records.record(i);
+				}));
+			}
+			records.wait_for_records(3);
+			auto fired = records.get_records();
+
+			assert(fired.size(), ==, 3u);
+			assert(fired[0].first, ==, 1);
+			assert(fired[1].first, ==, 2);
+			assert(fired[2].first, ==, 0);
+			bool early = false;
+			for (auto& [timer, time] : fired) {
+				early = early || time < deadlines[timer];
+			}
+			assert(early, ==, false);
+		};
+
+		test_case("timers in every level of the wheel should expire") {
+			timer_wheel timers(execute_inline, chrono::nanoseconds(1));
+			recorded_timers records;
+			auto now = chrono::steady_clock::now();
+			vector<chrono::nanoseconds> delays = {50ns, 3us, 200us, 12ms, 20ms};
+
+			for (size_t i = 0; i < delays.size(); i++) {
+				timers.schedule(now + delays[i], chrono::steady_clock::duration::zero(), task([&, i] {
+					records.record(i);
+				}));
+			}
+			records.wait_for_records(delays.size());
+			auto fired = records.get_records();
+
+			assert(fired.size(), ==, delays.size());
+			bool in_order = true;
+			for (size_t i = 0; i < fired.size(); i++) {
+				in_order = in_order && fired[i].first == (int)i && fired[i].second >= now + delays[i];
+			}
+			assert(in_order, ==, true);
+		};
+
+		test_case("cancelled timers should not expire") {
+			timer_wheel timers(execute_inline);
+			atomic<bool> fired(false);
+
+			auto handle = timers.schedule(chrono::steady_clock::now() + 10ms, chrono::steady_clock::duration::zero(), task([&] {
+				fired = true;
+			}));
+			handle.cancel();
+			this_thread::sleep_for(30ms);
+
+			assert(handle.is_cancelled(), ==, true);
+			assert(fired, ==, false);
+		};
+
+		test_case("cancelled timers should be removed from the wheel before they expire") {
+			timer_wheel timers(execute_inline);
+			vector<timer_handle> handles;
+
+			for (int i = 0; i < 100; i++) {
+				handles.push_back(timers.schedule(chrono::steady_clock::now() + 1h, chrono::steady_clock::duration::zero(), task([] {})));
+			}
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (timers.get_number_of_timers() < 100 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			for (int i = 0; i < 60; i++) {
+				handles[i].cancel();
+			}
+			while (timers.get_number_of_timers() > 50 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			assert(timers.get_number_of_timers(), <=, 50u);
+			assert(timers.get_number_of_timers(), >=, 40u);
+
+			for (auto& handle : handles) {
+				handle.cancel();
+			}
+			while (timers.get_number_of_timers() > 0 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			assert(timers.get_number_of_timers(), ==, 0u);
+		};
+
+		test_case("timers scheduled before the next deadline should wake the timer thread") {
+			timer_wheel timers(execute_inline);
+			recorded_timers records;
+
+			auto later = timers.schedule(chrono::steady_clock::now() + 10s, chrono::steady_clock::duration::zero(), task([&] {
+				records.record(0);
+			}));
+			this_thread::sleep_for(20ms);
+			auto deadline = chrono::steady_clock::now() + 10ms;
+			timers.schedule(deadline, chrono::steady_clock::duration::zero(), task([&] {
+				records.record(1);
+			}));
+
+			assert(records.wait_for_records(1), ==, true);
+			auto fired = records.get_records();
+			later.cancel();
+
+			assert(fired[0].first, ==, 1);
+			assert(fired[0].second, >=, deadline);
+			assert(fired[0].second, <, deadline + 1s);
+		};
+
+		test_case("periodic timers should expire until cancelled") {
+			timer_wheel timers(execute_inline);
+			atomic<int> expirations(0);
+
+			auto handle = timers.schedule(chrono::steady_clock::now() + 2ms, 2ms, task([&] {
+				expirations++;
+			}));
+			auto deadline = chrono::steady_clock::now() + 5s;
+			while (expirations < 5 && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(1ms);
+			}
+			handle.cancel();
+			this_thread::sleep_for(10ms);
+			int expirations_after_cancel = expirations;
+			this_thread::sleep_for(20ms);
+
+			assert(expirations_after_cancel, >=, 5);
+			assert(expirations, ==, expirations_after_cancel);
+		};
+
+		test_case("many timers should be handed over in batches") {
+			atomic<int> batches(0);
+			atomic<int> expirations(0);
+			timer_wheel timers([&](vector<task>&& expired_tasks) {
+				batches++;
+				execute_inline(std::move(expired_tasks));
+			});
+
+			auto deadline = chrono::steady_clock::now() + 5ms;
+			for (int i = 0; i < 10000; i++) {
+				timers.schedule(deadline, chrono::steady_clock::duration::zero(), task([&] {
+					expirations++;
+				}));
+			}
+			auto wait_deadline = chrono::steady_clock::now() + 5s;
+			while (expirations < 10000 && chrono::steady_clock::now() < wait_deadline) {
+				this_thread::sleep_for(1ms);
+			}
+
+			assert(expirations, ==, 10000);
+			assert(batches, <, 100);
+		};
+	}
+} end_tests;
@@ -0,0 +1,143 @@
+#include <assertions-test/test.h>
+#include <tracing.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace parallel_tools;
+using namespace std;
+
+namespace {
+	size_t count_occurrences(const string& text, const string& pattern) {
+		size_t occurrences = 0;
+		for (auto position = text.find(pattern); position != string::npos; position = text.find(pattern, position + 1)) {
+			occurrences++;
+		}
+		return occurrences;
+	}
+}
+
+begin_tests {
+	test_suite("when recording events in trace buffers") {
+		test_case("events should be read in the order they were recorded") {
+			trace_buffer buffer;
+
+			buffer.record(trace_event_type::task, 10, 20, 5);
+			buffer.record(trace_event_type::swap, 30, 35, 64);
+			auto events = buffer.read();
+
+			assert(events.size(), ==, 2u);
+			assert(events[0].type == trace_event_type::task, ==, true);
+			assert(events[0].begin, ==, 10);
+			assert(events[0].end, ==, 20);
+			assert(events[0].argument, ==, 5);
+			assert(events[1].type == trace_event_type::swap, ==, true);
+			assert(events[1].argument, ==, 64);
+		};
+
+		test_case("full buffers should keep only the most recent events") {
+			trace_buffer buffer;
+
+			for (size_t i = 0; i < trace_buffer::capacity + 10; i++) {
+				buffer.record(trace_event_type::task, i, i + 1, 0);
+			}
+			auto events = buffer.read();
+
+			assert(events.size(), ==, trace_buffer::capacity);
+			assert(events.front().begin, ==, 10);
+			assert(events.back().begin, ==, int64_t(trace_buffer::capacity + 9));
+		};
+	}
+
+	test_suite("when writing chrome traces") {
+		test_case("traces should contain tasks, swaps, idle periods and worker names") {
+			trace_recorder<true> recorder;
+			auto first_worker = recorder.register_worker("decoder", 0);
+			auto second_worker = recorder.register_worker("", 1);
+
+			first_worker->record(trace_event_type::task, 1000, 2000, 500);
+			first_worker->record(trace_event_type::swap, 2500, 2600, 32);
+			first_worker->record(trace_event_type::task, 3000, 4000, 2000);
+			second_worker->record(trace_event_type::task, 1500, 1700, 1000);
+			stringstream output;
+			recorder.write_chrome_trace(output);
+			auto trace = output.str();
+
+			assert(trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), ==, 0u);
+			assert(count_occurrences(trace, "\"name\":\"task\""), ==, 3u);
+			assert(count_occurrences(trace, "\"name\":\"swap\""), ==, 1u);
+			assert(count_occurrences(trace, "\"name\":\"idle\""), ==, 1u);
+			assert(trace.find("\"args\":{\"name\":\"decoder-0\"}"), !=, string::npos);
+			assert(trace.find("\"args\":{\"name\":\"worker-1\"}"), !=, string::npos);
+			assert(trace.find("\"resources\":32"), !=, string::npos);
+		};
+
+		test_case("timestamps should be converted to microseconds") {
+			trace_recorder<true> recorder;
+			auto worker = recorder.register_worker("worker", 0);
+
+			auto submitted = trace_clock();
+			this_thread::sleep_for(2ms);
+			auto begin = trace_clock();
+			this_thread::sleep_for(5ms);
+			worker->record(trace_event_type::task, begin, trace_clock(), submitted);
+			stringstream output;
+			recorder.write_chrome_trace(output);
+			auto trace = output.str();
+			auto duration_position = trace.find("\"dur\":");
+			auto queued_position = trace.find("\"queued_us\":");
+			auto duration = stod(trace.substr(duration_position + 6));
+			auto queued = stod(trace.substr(queued_position + 12));
+
+			assert(duration_position, !=, string::npos);
+			assert(queued_position, !=, string::npos);
+			assert(duration, >=, 4500.0);
+			assert(duration, <, 500000.0);
+			assert(queued, >=, 1500.0);
+			assert(queued, <, 500000.0);
+			assert(trace.find("\"submitted_us\":0.000"), !=, string::npos);
+		};
+
+		test_case("retired buffers should be reused by new workers") {
+			trace_recorder<true> recorder;
+			auto retired_worker = recorder.register_worker("worker", 0);
+			auto begin = trace_clock();
+			retired_worker->record(trace_event_type::task, begin, begin + 1, begin);
+
+			recorder.retire_worker(retired_worker);
+			auto new_worker = recorder.register_worker("worker", 2);
+			stringstream output;
+			recorder.write_chrome_trace(output);
+
+			assert(new_worker == retired_worker, ==, true);
+			assert(new_worker->read().empty(), ==, true);
+			assert(output.str().find("worker-2"), !=, string::npos);
+			assert(output.str().find("worker-0"), !=, string::npos);
+			assert(count_occurrences(output.str(), "\"name\":\"task\""), ==, 1u);
+		};
+
+		test_case("writing a trace should restore the stream's formatting") {
+			trace_recorder<true> recorder;
+			auto worker = recorder.register_worker("worker", 0);
+			auto begin = trace_clock();
+			worker->record(trace_event_type::task, begin, begin + 1, begin);
+			stringstream output;
+			output.precision(9);
+
+			recorder.write_chrome_trace(output);
+
+			assert(output.precision(), ==, 9);
+			assert((output.flags() & ios_base::floatfield) == ios_base::fmtflags(), ==, true);
+		};
+
+		test_case("worker names should be escaped") {
+			trace_recorder<true> recorder;
+			recorder.register_worker("\"quoted\"\\", 0);
+			stringstream output;
+			recorder.write_chrome_trace(output);
+
+			assert(output.str().find("\\\"quoted\\\"\\\\-0"), !=, string::npos);
+		};
+	}
+} end_tests;
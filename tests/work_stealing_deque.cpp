@@ -0,0 +1,93 @@
+#include <assertions-test/test.h>
+#include <work_stealing_deque.h>
+#include <future>
+#include <vector>
+
+using namespace std;
+
+begin_tests {
+	test_suite("when pushing and taking from a single thread") {
+		test_case("the owner should take resources in reverse order") {
+			parallel_tools::work_stealing_deque<int> deque;
+			for (int i = 0; i < 3; i++) {
+				deque.push(i);
+			}
+
+			assert(deque.take().value_or(-1), ==, 2);
+			assert(deque.take().value_or(-1), ==, 1);
+			assert(deque.take().value_or(-1), ==, 0);
+			assert(deque.take().has_value(), ==, false);
+		};
+
+		test_case("thieves should steal resources in order") {
+			parallel_tools::work_stealing_deque<int> deque;
+			for (int i = 0; i < 3; i++) {
+				deque.push(i);
+			}
+
+			assert(deque.steal().value_or(-1), ==, 0);
+			assert(deque.steal().value_or(-1), ==, 1);
+			assert(deque.take().value_or(-1), ==, 2);
+			assert(deque.steal().has_value(), ==, false);
+			assert(deque.empty(), ==, true);
+		};
+
+		test_case("the deque should grow to hold every resource") {
+			parallel_tools::work_stealing_deque<int> deque;
+			for (int i = 0; i < 1000; i++) {
+				deque.push(i);
+			}
+
+			assert(deque.size(), ==, 1000u);
+			bool ordered = true;
+			for (int i = 0; i < 1000; i++) {
+				if (deque.steal().value_or(-1) != i) {
+					ordered = false;
+				}
+			}
+			assert(ordered, ==, true);
+		};
+	}
+
+	test_suite("when stealing while the owner pushes and takes") {
+		test_case("every resource should be obtained exactly once") {
+			constexpr int resources = 200000;
+			parallel_tools::work_stealing_deque<int> deque;
+			atomic<bool> done(false);
+			vector<atomic<int>> obtained(resources);
+			for (auto& counter : obtained) {
+				counter = 0;
+			}
+
+			auto steal_until_done = [&] {
+				while (!done || !deque.empty()) {
+					if (auto resource = deque.steal()) {
+						obtained[*resource]++;
+					}
+				}
+			};
+			auto thief1 = async(launch::async, steal_until_done);
+			auto thief2 = async(launch::async, steal_until_done);
+
+			for (int i = 0; i < resources; i++) {
+				deque.push(i);
+				if (i % 3 == 0) {
+					if (auto resource = deque.take()) {
+						obtained[*resource]++;
+					}
+				}
+			}
+			done = true;
+			thief1.wait();
+			thief2.wait();
+
+			bool obtained_once = true;
+			for (auto& counter : obtained) {
+				if (counter != 1) {
+					obtained_once = false;
+				}
+			}
+			assert(obtained_once, ==, true);
+		};
+	}
+} end_tests;